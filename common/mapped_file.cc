@@ -0,0 +1,55 @@
+#include "common/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <mutex>
+
+#include <common/log.h>
+
+namespace chainer_compiler {
+
+MappedFile::MappedFile(const std::string& filename, int64_t offset, int64_t length, bool writable)
+    : filename_(filename), offset_(offset) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    CHECK_LE(0, fd) << "Failed to open: " << filename;
+    struct stat st;
+    CHECK_EQ(0, fstat(fd, &st)) << filename;
+    if (length < 0) length = st.st_size - offset;
+    CHECK_LE(0, offset) << filename;
+    CHECK_LE(offset + length, st.st_size) << "Out of range: " << filename;
+    size_ = length;
+    const int64_t page_size = sysconf(_SC_PAGESIZE);
+    map_offset_ = offset / page_size * page_size;
+    map_size_ = offset + length - map_offset_;
+    const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    addr_ = map_size_ ? mmap(nullptr, map_size_, prot, MAP_PRIVATE, fd, map_offset_) : nullptr;
+    CHECK_NE(MAP_FAILED, addr_) << "Failed to mmap: " << filename;
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (addr_) munmap(addr_, map_size_);
+}
+
+std::shared_ptr<const MappedFile> MapFile(const std::string& filename) {
+    static std::mutex mu;
+    static std::map<std::string, std::weak_ptr<const MappedFile>> mapped_files;
+    std::lock_guard<std::mutex> lock(mu);
+    std::weak_ptr<const MappedFile>& mapped = mapped_files[filename];
+    std::shared_ptr<const MappedFile> file = mapped.lock();
+    if (!file) {
+        file = std::make_shared<const MappedFile>(filename, 0, -1, false /* writable */);
+        mapped = file;
+    }
+    return file;
+}
+
+std::shared_ptr<MappedFile> MapFilePrivate(const std::string& filename, int64_t offset, int64_t length) {
+    return std::make_shared<MappedFile>(filename, offset, length, true /* writable */);
+}
+
+}  // namespace chainer_compiler
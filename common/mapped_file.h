@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace chainer_compiler {
+
+// A private memory mapping of `length` bytes of a file from `offset`,
+// or of the whole file if `length` is negative. Pages are read lazily
+// and physically shared with other mappings of the same file.
+// Read-only mappings must not be written. Writes to a writable mapping
+// copy the touched pages, so they are visible neither to other
+// mappings nor to the file.
+class MappedFile {
+public:
+    MappedFile(const std::string& filename, int64_t offset, int64_t length, bool writable);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // The first byte of the mapped range, i.e., at `offset` in the file.
+    char* data() const {
+        return static_cast<char*>(addr_) + (offset_ - map_offset_);
+    }
+    size_t size() const {
+        return size_;
+    }
+    int64_t offset() const {
+        return offset_;
+    }
+    const std::string& filename() const {
+        return filename_;
+    }
+
+private:
+    std::string filename_;
+    int64_t offset_;
+    size_t size_;
+    // `mmap` needs a page-aligned offset, so the mapping starts at
+    // `map_offset_` <= `offset_`.
+    int64_t map_offset_;
+    size_t map_size_;
+    void* addr_;
+};
+
+// Returns a read-only mapping of the whole `filename`, which is shared
+// by all callers in the process while it is alive.
+std::shared_ptr<const MappedFile> MapFile(const std::string& filename);
+
+// Returns a new writable mapping of `length` bytes of `filename` from
+// `offset` (the whole file if `length` is negative), which is not
+// shared with any other caller.
+std::shared_ptr<MappedFile> MapFilePrivate(const std::string& filename, int64_t offset = 0, int64_t length = -1);
+
+}  // namespace chainer_compiler
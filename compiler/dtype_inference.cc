@@ -339,6 +339,9 @@ void InferDtype(Node* node) {
         }
 
         case Node::kChainerPrint:
+        case Node::kChainerMomentumSGDUpdate:
+        case Node::kChainerAdamUpdate:
+        case Node::kChainerAccumulateGrads:
             break;
 
         case Node::kChainerNullConstant:
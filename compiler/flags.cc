@@ -10,6 +10,8 @@ bool g_skip_inference;
 
 bool g_replace_constant;
 
+bool g_prepack_weights;
+
 int g_recompute_relu;
 
 bool g_modify_pool_with_imbalanced_pads;
@@ -28,6 +30,12 @@ std::string g_dump_autotvm_task_dir;
 
 std::string g_autotvm_log;
 
+std::string g_optimizer;
+float g_momentum;
+float g_weight_decay;
+
+bool g_accumulate_grads;
+
 std::string g_backend_name;
 
 bool g_dump_after_inference;
@@ -18,6 +18,11 @@ extern bool g_skip_inference;
 // Similar to onnx/optimizer/passes/extract_constant_to_initializer.h
 extern bool g_replace_constant;
 
+// Transposes weights used by Gemm(transB=1) or Transpose into new
+// initializers at compile time for inference. Only for callers which
+// never feed the original weights at runtime.
+extern bool g_prepack_weights;
+
 // Recomputes Relu ops when the results are used by backprop after
 // this number of steps.
 extern int g_recompute_relu;
@@ -48,6 +53,18 @@ extern std::string g_dump_autotvm_task_dir;
 // A tuning log of AutoTVM which contains best scheduling parameters.
 extern std::string g_autotvm_log;
 
+// Updates parameters in the training graph with this optimizer
+// ("momentum_sgd" or "adam") instead of exposing gradients as
+// outputs. Weight decay is added to gradients before the update.
+extern std::string g_optimizer;
+extern float g_momentum;
+extern float g_weight_decay;
+
+// Adds gradients of the training graph to grad_accum@ inputs in
+// place instead of exposing them as outputs, so a batch can be split
+// into micro-batches which run one by one.
+extern bool g_accumulate_grads;
+
 // The name of backend.
 extern std::string g_backend_name;
 
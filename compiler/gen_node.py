@@ -211,6 +211,17 @@ NodeDef('ChainerFusionGroup', None, None, subgraph=Graph, fusion_type=str)
 
 NodeDef('ChainerPrint', None, 0)
 
+# Updates parameters and optimizer states in place. The first two
+# inputs are the learning rate and the scale of gradients.
+# (lr, grad_scale, params..., grads..., velocities...) -> ()
+# Velocities are omitted when `momentum` is zero.
+NodeDef('ChainerMomentumSGDUpdate', None, 0, momentum=0.9, weight_decay=0.0)
+# (lr, grad_scale, step, params..., grads..., ms..., vs...) -> ()
+NodeDef('ChainerAdamUpdate', None, 0,
+        beta1=0.9, beta2=0.999, epsilon=1e-8, weight_decay=0.0)
+# Adds gradients to accumulators in place: (accums..., grads...) -> ()
+NodeDef('ChainerAccumulateGrads', None, 0)
+
 # Put a null value.
 NodeDef('ChainerNullConstant', 0, 1)
 
@@ -5,10 +5,13 @@
 #include <map>
 #include <set>
 #include <stack>
+#include <utility>
+#include <vector>
 
 #include <compiler/onnx.h>
 
 #include <common/log.h>
+#include <compiler/flags.h>
 #include <compiler/gradient_ops.h>
 #include <compiler/graph.h>
 #include <compiler/graph_builder.h>
@@ -37,7 +40,9 @@ void SetInitialGradients(Graph* graph) {
     }
 }
 
-void ExposeParamGradsAsOutputs(Graph* graph, Graph* dest_graph, const std::set<Value*>& xs) {
+// Returns pairs of parameters in `xs` and their gradients.
+std::vector<std::pair<Value*, Value*>> GetParamGrads(Graph* graph, const std::set<Value*>& xs) {
+    std::vector<std::pair<Value*, Value*>> param_grads;
     bool ok = true;
     for (Value* input : graph->input_values()) {
         if (!xs.count(input)) continue;
@@ -48,14 +53,80 @@ void ExposeParamGradsAsOutputs(Graph* graph, Graph* dest_graph, const std::set<V
             ok = false;
             continue;
         }
-        Value* out_grad = dest_graph->AddOutputValue("grad_out@" + input->name(), input->type());
-        dest_graph->AddNode(Node::kIdentity, {input->grad()}, {out_grad});
+        param_grads.emplace_back(input, input->grad());
     }
     if (!ok) {
         graph->DumpONNXOnFailure();
         CHECK(false);
     }
+    return param_grads;
+}
 
+void ExposeParamGradsAsOutputs(Graph* graph, Graph* dest_graph, const std::set<Value*>& xs) {
+    for (const auto& p : GetParamGrads(graph, xs)) {
+        Value* out_grad = dest_graph->AddOutputValue("grad_out@" + p.first->name(), p.first->type());
+        dest_graph->AddNode(Node::kIdentity, {p.second}, {out_grad});
+    }
+    graph->ResetGradients();
+}
+
+// Adds an input with a zero-filled initializer shaped like `param`.
+Value* AddZerosLike(Graph* graph, const std::string& name, Value* param) {
+    const Tensor& w = *param->initializer();
+    CHECK_EQ(Dtype::kFloat32, w.dtype()) << "Only float32 parameters are supported: " << param->name();
+    return graph->AddConstValue(name, Type(w.dtype(), w.dims()), std::vector<float>(w.NumElements()));
+}
+
+// Appends a node which adds gradients to grad_accum@ inputs in place.
+void AddGradAccumulation(Graph* graph, const std::set<Value*>& xs) {
+    std::vector<Value*> accums, grads;
+    for (const auto& p : GetParamGrads(graph, xs)) {
+        accums.push_back(AddZerosLike(graph, "grad_accum@" + p.first->name(), p.first));
+        grads.push_back(p.second);
+    }
+    accums.insert(accums.end(), grads.begin(), grads.end());
+    graph->AddNode(Node::kChainerAccumulateGrads, accums, {});
+    graph->ResetGradients();
+}
+
+// Appends a node which updates parameters with `g_optimizer` in
+// place. Optimizer states are added as inputs with zero-filled
+// initializers so they persist across steps as parameters do.
+void AddOptimizerUpdate(Graph* graph, const std::set<Value*>& xs) {
+    std::vector<std::pair<Value*, Value*>> param_grads = GetParamGrads(graph, xs);
+    auto add_scalar = [graph](const std::string& name, float value) {
+        return graph->AddConstValue("optimizer@" + name, Type(Dtype::kFloat32, {}), std::vector<float>{value});
+    };
+    auto add_states = [graph, &param_grads](const std::string& prefix, std::vector<Value*>* inputs) {
+        for (const auto& p : param_grads) inputs->push_back(AddZerosLike(graph, prefix + "@" + p.first->name(), p.first));
+    };
+
+    std::vector<Value*> inputs;
+    Node::OpType op_type;
+    if (g_optimizer == "momentum_sgd") {
+        op_type = Node::kChainerMomentumSGDUpdate;
+        inputs.push_back(add_scalar("lr", 0.01));
+        inputs.push_back(add_scalar("grad_scale", 1));
+    } else if (g_optimizer == "adam") {
+        op_type = Node::kChainerAdamUpdate;
+        inputs.push_back(add_scalar("lr", 0.001));
+        inputs.push_back(add_scalar("grad_scale", 1));
+        inputs.push_back(add_scalar("step", 0));
+    } else {
+        QFAIL() << "Unknown optimizer: " << g_optimizer;
+    }
+    for (const auto& p : param_grads) inputs.push_back(p.first);
+    for (const auto& p : param_grads) inputs.push_back(p.second);
+    if (op_type == Node::kChainerMomentumSGDUpdate) {
+        if (g_momentum) add_states("optimizer_velocity", &inputs);
+    } else {
+        add_states("optimizer_m", &inputs);
+        add_states("optimizer_v", &inputs);
+    }
+
+    Node* node = graph->AddNode(op_type, inputs, {});
+    if (op_type == Node::kChainerMomentumSGDUpdate) node->set_momentum(g_momentum);
+    node->set_weight_decay(g_weight_decay);
     graph->ResetGradients();
 }
 
@@ -127,7 +198,14 @@ void AddGradientNodesForTraining(Graph* graph) {
     std::set<Value*> xs = GetParamValues(graph);
     GenerateGradientNodes(graph, graph, std::vector<Value*>(xs.begin(), xs.end()), graph->output_values(), nullptr);
 
-    ExposeParamGradsAsOutputs(graph, graph, xs);
+    if (g_accumulate_grads) {
+        CHECK(g_optimizer.empty()) << "Gradient accumulation does not work with in-graph optimizers";
+        AddGradAccumulation(graph, xs);
+    } else if (g_optimizer.empty()) {
+        ExposeParamGradsAsOutputs(graph, graph, xs);
+    } else {
+        AddOptimizerUpdate(graph, xs);
+    }
 }
 
 void GenerateGradientNodes(Graph* graph, Graph* dest_graph) {
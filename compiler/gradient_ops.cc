@@ -257,12 +257,37 @@ void IdentityGradFn(GradientOpContext* gc) {
     gc->GradOp(Node::kIdentity, 0, {gc->gy(0)});
 }
 
+void DropoutGradFn(GradientOpContext* gc) {
+    Value* mask = gc->node()->outputs().size() == 1 ? gc->AddOutput(gc->x(0)->type()) : gc->y(1);
+    gc->GradOp(Node::kMul, 0, {gc->gy(0), mask});
+}
+
 void ReshapeGradFn(GradientOpContext* gc) {
     GraphBuilder gb{gc->builder(0)};
     Value* t0 = gb.Op(Node::kShape, {gc->x(0)});
     gc->GradOp(Node::kReshape, 0, {gc->gy(0), t0});
 }
 
+void ConcatGradFn(GradientOpContext* gc) {
+    const Node* node = gc->node();
+    // Concat with dynamic lengths is lowered to sequence ops by the
+    // simplifier, so all lengths along `axis` must be known here.
+    std::vector<int64_t> lens;
+    std::vector<int> xis;
+    int64_t axis = node->axis();
+    for (size_t i = 0; i < node->inputs().size(); ++i) {
+        const Type& type = gc->NoRetainX(i)->type();
+        CHECK(type.HasKnownShape()) << node->DebugString();
+        if (node->axis() < 0) axis = node->axis() + type.ndim();
+        CHECK_LE(0, axis) << node->DebugString();
+        CHECK_LT(axis, type.ndim()) << node->DebugString();
+        lens.push_back(type.dims()[axis]);
+        xis.push_back(i);
+    }
+    std::vector<Value*> gxs = gc->GradMOp(Node::kSplit, xis, {gc->gy(0)});
+    gxs[0]->producer()->set_axis(axis)->set_split(lens);
+}
+
 void SelectItemGradFn(GradientOpContext* gc) {
     GraphBuilder gb{gc->builder(0)};
     Value* t0 = gb.Op(Node::kShape, {gc->x(0)});
@@ -931,6 +956,7 @@ bool AddGradientForNode(Graph* graph, Graph* dest_graph, Node* node, std::map<Va
         register_grad_fn(Node::kReshape, &ReshapeGradFn);
         register_grad_fn(Node::kSqueeze, &ReshapeGradFn);
         register_grad_fn(Node::kUnsqueeze, &ReshapeGradFn);
+        register_grad_fn(Node::kConcat, &ConcatGradFn);
         register_grad_fn(Node::kChainerSelectItem, &SelectItemGradFn);
         register_grad_fn(Node::kGather, &GatherGradFn);
         register_grad_fn(Node::kExpand, &ExpandGradFn);
@@ -952,8 +978,7 @@ bool AddGradientForNode(Graph* graph, Graph* dest_graph, Node* node, std::map<Va
         register_grad_fn(Node::kChainerLinear, &LinearGradFn);
         register_grad_fn(Node::kLSTM, &LSTMGradFn);
 
-        // TODO(hamaji): Implement dropout.
-        register_grad_fn(Node::kDropout, &IdentityGradFn);
+        register_grad_fn(Node::kDropout, &DropoutGradFn);
 
         register_grad_fn(Node::kGreater, &DoNothingGradFn);
         register_grad_fn(Node::kConstant, &DoNothingGradFn);
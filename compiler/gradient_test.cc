@@ -3,6 +3,7 @@
 #include <compiler/onnx.h>
 
 #include <common/log.h>
+#include <compiler/flags.h>
 #include <compiler/gradient.h>
 #include <compiler/graph.h>
 #include <compiler/node.h>
@@ -44,5 +45,73 @@ TEST(GradientTest, Basic) {
     EXPECT_EQ(1, output_names.count("grad_out@in2"));
 }
 
+TEST(GradientTest, InGraphOptimizer) {
+    onnx::TensorProto dummy_input;
+    dummy_input.set_data_type(onnx::TensorProto::FLOAT);
+    dummy_input.add_dims(1);
+    dummy_input.add_float_data(1.0);
+
+    Graph graph("test");
+    Value* out = graph.AddOutputValue("out", Type(Dtype::kFloat32, {1}));
+    Value* in0 = graph.AddInputValue("in0", Type(Dtype::kFloat32, {1}));
+    in0->ResetInitializer(std::make_unique<Tensor>(dummy_input));
+    Value* in1 = graph.AddInputValue("in1", Type(Dtype::kFloat32, {1}));
+    in1->ResetInitializer(std::make_unique<Tensor>(dummy_input));
+    graph.AddNode(Node::kMul, {in0, in1}, {out});
+
+    g_optimizer = "momentum_sgd";
+    g_momentum = 0.9;
+    AddGradientNodesForTraining(&graph);
+    g_optimizer = "";
+
+    // Gradients stay in the graph and are consumed by the update.
+    ASSERT_EQ(1UL, graph.output_values().size());
+    std::vector<Node*> updates;
+    for (Node* node : graph.nodes()) {
+        if (node->op_type() == Node::kChainerMomentumSGDUpdate) updates.push_back(node);
+    }
+    ASSERT_EQ(1UL, updates.size());
+    // lr, grad_scale, two params, two grads, and two velocities.
+    ASSERT_EQ(8UL, updates[0]->inputs().size());
+    EXPECT_EQ("optimizer@lr", updates[0]->input(0)->name());
+    EXPECT_EQ("optimizer@grad_scale", updates[0]->input(1)->name());
+    EXPECT_EQ(in0, updates[0]->input(2));
+    EXPECT_EQ(in1, updates[0]->input(3));
+    EXPECT_EQ("optimizer_velocity@in0", updates[0]->input(6)->name());
+    EXPECT_EQ("optimizer_velocity@in1", updates[0]->input(7)->name());
+    EXPECT_TRUE(updates[0]->input(6)->initializer());
+    EXPECT_FLOAT_EQ(0.9, updates[0]->momentum());
+}
+
+TEST(GradientTest, GradAccumulation) {
+    onnx::TensorProto dummy_input;
+    dummy_input.set_data_type(onnx::TensorProto::FLOAT);
+    dummy_input.add_dims(1);
+    dummy_input.add_float_data(1.0);
+
+    Graph graph("test");
+    Value* out = graph.AddOutputValue("out", Type(Dtype::kFloat32, {1}));
+    Value* in0 = graph.AddInputValue("in0", Type(Dtype::kFloat32, {1}));
+    in0->ResetInitializer(std::make_unique<Tensor>(dummy_input));
+    Value* in1 = graph.AddInputValue("in1", Type(Dtype::kFloat32, {1}));
+    in1->ResetInitializer(std::make_unique<Tensor>(dummy_input));
+    graph.AddNode(Node::kMul, {in0, in1}, {out});
+
+    g_accumulate_grads = true;
+    AddGradientNodesForTraining(&graph);
+    g_accumulate_grads = false;
+
+    ASSERT_EQ(1UL, graph.output_values().size());
+    std::vector<Node*> accums;
+    for (Node* node : graph.nodes()) {
+        if (node->op_type() == Node::kChainerAccumulateGrads) accums.push_back(node);
+    }
+    ASSERT_EQ(1UL, accums.size());
+    ASSERT_EQ(4UL, accums[0]->inputs().size());
+    EXPECT_EQ("grad_accum@in0", accums[0]->input(0)->name());
+    EXPECT_EQ("grad_accum@in1", accums[0]->input(1)->name());
+    EXPECT_TRUE(accums[0]->input(0)->initializer());
+}
+
 }  // namespace
 }  // namespace chainer_compiler
@@ -59,4 +59,37 @@ void Model::ResetGraph(Graph* graph) {
     graph_.reset(graph);
 }
 
+namespace {
+
+void ResolveExternalDataLocations(const std::string& dir, onnx::TensorProto* xtensor) {
+    if (xtensor->data_location() != onnx::TensorProto::EXTERNAL) return;
+    for (onnx::StringStringEntryProto& entry : *xtensor->mutable_external_data()) {
+        if (entry.key() == "location" && !entry.value().empty() && entry.value()[0] != '/') {
+            entry.set_value(dir + entry.value());
+        }
+    }
+}
+
+void ResolveExternalDataLocations(const std::string& dir, onnx::GraphProto* xgraph) {
+    for (onnx::TensorProto& xtensor : *xgraph->mutable_initializer()) {
+        ResolveExternalDataLocations(dir, &xtensor);
+    }
+    for (onnx::NodeProto& xnode : *xgraph->mutable_node()) {
+        for (onnx::AttributeProto& xattr : *xnode.mutable_attribute()) {
+            if (xattr.has_t()) ResolveExternalDataLocations(dir, xattr.mutable_t());
+            for (onnx::TensorProto& xtensor : *xattr.mutable_tensors()) ResolveExternalDataLocations(dir, &xtensor);
+            if (xattr.has_g()) ResolveExternalDataLocations(dir, xattr.mutable_g());
+            for (onnx::GraphProto& xsubgraph : *xattr.mutable_graphs()) ResolveExternalDataLocations(dir, &xsubgraph);
+        }
+    }
+}
+
+}  // namespace
+
+void ResolveExternalDataLocations(const std::string& model_path, onnx::ModelProto* xmodel) {
+    const size_t slash = model_path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "" : model_path.substr(0, slash + 1);
+    ResolveExternalDataLocations(dir, xmodel->mutable_graph());
+}
+
 }  // namespace chainer_compiler
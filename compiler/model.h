@@ -69,4 +69,9 @@ private:
     std::unique_ptr<Graph> graph_;
 };
 
+// Makes locations of external data in `xmodel` absolute so tensors can
+// be loaded regardless of the working directory. Relative locations
+// are resolved from the directory of `model_path`.
+void ResolveExternalDataLocations(const std::string& model_path, onnx::ModelProto* xmodel);
+
 }  // namespace chainer_compiler
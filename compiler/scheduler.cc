@@ -256,6 +256,12 @@ int64_t ScheduleComputation(
 
     CheckSanity(graph, input_values, output_values, nodes);
 
+    // Optimizers overwrite parameters in place, so they must run after
+    // every other node which may read the parameters.
+    std::stable_partition(nodes.begin(), nodes.end(), [](const Node* node) {
+        return node->op_type() != Node::kChainerMomentumSGDUpdate && node->op_type() != Node::kChainerAdamUpdate;
+    });
+
     for (Node* node : nodes) {
         node->set_chainer_order(++order);
     }
@@ -1,7 +1,10 @@
 #include "compiler/simplifier.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <limits>
+#include <memory>
 
 #include <common/log.h>
 #include <common/strutil.h>
@@ -10,6 +13,8 @@
 #include <compiler/graph.h>
 #include <compiler/graph_builder.h>
 #include <compiler/node.h>
+#include <compiler/tensor.h>
+#include <compiler/type.h>
 #include <compiler/value.h>
 
 namespace chainer_compiler {
@@ -471,7 +476,20 @@ bool ReplaceAveragePool(Graph* graph, Node* node) {
     return true;
 }
 
+bool HasStaticConcatLengths(const Node& node) {
+    for (Value* v : node.inputs()) {
+        const Type& type = v->type();
+        if (!type.HasKnownShape() || type.ndim() == 0) return false;
+        int64_t axis = node.axis() < 0 ? node.axis() + type.ndim() : node.axis();
+        if (axis < 0 || axis >= type.ndim() || type.dims()[axis] <= 0) return false;
+    }
+    return true;
+}
+
+// Concat with static lengths has its own gradient (Split), so only
+// Concat with dynamic lengths is lowered to sequence ops.
 bool ReplaceConcat(Graph* graph, Node* node) {
+    if (HasStaticConcatLengths(*node)) return false;
     GraphBuilder gb(graph, "SimplifyConcat", node->output(0));
     Value* seq = gb.Op(Node::kChainerSequenceCreate, {});
     for (Value* v : node->inputs()) {
@@ -624,6 +642,123 @@ bool ReplaceImageScaler(Graph* graph, Node* node) {
     return true;
 }
 
+bool IsIdentityPermutation(const std::vector<int64_t>& perm) {
+    for (int64_t i = 0; i < static_cast<int64_t>(perm.size()); ++i) {
+        if (perm[i] != i) return false;
+    }
+    return true;
+}
+
+// Merges consecutive Transpose ops and removes no-op Transpose.
+bool ReplaceTranspose(Graph* graph, Node* node) {
+    const std::vector<int64_t>& perm = node->perm();
+    if (perm.empty()) return false;
+    GraphBuilder gb(graph, "SimplifyTranspose", node->output(0));
+    if (IsIdentityPermutation(perm)) {
+        gb.Op(Node::kIdentity, {node->input(0)}, node->output(0));
+        return true;
+    }
+
+    Node* inner = node->input(0)->producer();
+    if (!inner || inner->op_type() != Node::kTranspose) return false;
+    const std::vector<int64_t>& inner_perm = inner->perm();
+    if (inner_perm.size() != perm.size()) return false;
+    std::vector<int64_t> merged;
+    for (int64_t p : perm) merged.push_back(inner_perm[p]);
+    if (IsIdentityPermutation(merged)) {
+        gb.Op(Node::kIdentity, {inner->input(0)}, node->output(0));
+    } else {
+        gb.Op(Node::kTranspose, {inner->input(0)}, node->output(0))->producer()->set_perm(merged);
+    }
+    return true;
+}
+
+// Moves a Transpose after an element-wise unary op so Transpose ops
+// sink towards the boundary of a region, where `ReplaceTranspose`
+// can cancel inverse pairs (e.g., NHWC models exported as
+// Transpose-Conv-Transpose).
+bool SwapTransposeAndUnary(Graph* graph, Node* node) {
+    Node* transpose = node->input(0)->producer();
+    if (!transpose || transpose->op_type() != Node::kTranspose) return false;
+    if (transpose->output(0)->users().size() != 1 || !transpose->output(0)->IsTemp()) return false;
+    GraphBuilder gb(graph, "SimplifyTransposeUnary", node->output(0));
+    Value* x = transpose->input(0);
+    Value* y = gb.Op(node->op_type(), {x});
+    if (x->type().kind() == Type::Kind::kTensor && x->type().HasKnownShape()) {
+        y->set_type(new Type(x->type()));
+    }
+    gb.Op(Node::kTranspose, {y}, node->output(0))->producer()->set_perm(transpose->perm());
+    return true;
+}
+
+// Returns a new input whose initializer is the initializer of `v`
+// permuted by `perm`, so the transposition is paid once at compile
+// time instead of on every run. `v` loses its only user and will not
+// be loaded. This is only done for weights used by a single node.
+Value* PrepackInitializer(Graph* graph, Value* v, const std::vector<int64_t>& perm) {
+    const Tensor* tensor = v->initializer();
+    if (!tensor || v->IsOutput() || v->users().size() != 1) return nullptr;
+    const std::vector<int64_t> dims = tensor->dims();
+    if (dims.size() != perm.size()) return nullptr;
+
+    const int ndim = dims.size();
+    std::vector<int64_t> strides(ndim, 1);
+    for (int i = ndim - 2; i >= 0; --i) strides[i] = strides[i + 1] * dims[i + 1];
+    std::vector<int64_t> packed_dims;
+    for (int64_t p : perm) packed_dims.push_back(dims[p]);
+
+    const int64_t elem_size = tensor->dtype().SizeOf();
+    const int64_t num_elements = tensor->NumElements();
+    Tensor::UniqueData data(std::malloc(std::max<int64_t>(1, num_elements * elem_size)), &std::free);
+    const char* src = static_cast<const char*>(tensor->GetRawData());
+    char* dst = static_cast<char*>(data.get());
+    std::vector<int64_t> index(ndim);
+    for (int64_t i = 0; i < num_elements; ++i) {
+        int64_t offset = 0;
+        for (int j = 0; j < ndim; ++j) offset += index[j] * strides[perm[j]];
+        std::memcpy(dst + i * elem_size, src + offset * elem_size, elem_size);
+        for (int j = ndim - 1; j >= 0; --j) {
+            if (++index[j] < packed_dims[j]) break;
+            index[j] = 0;
+        }
+    }
+
+    const Dtype dtype = tensor->dtype();
+    const std::string& name = StrCat("SimplifyPrepack_", v->name());
+    Value* packed = graph->AddInputValue(name, Type(dtype, packed_dims));
+    packed->ResetInitializer(std::make_unique<Tensor>(name, dtype, packed_dims, std::move(data)));
+    return packed;
+}
+
+bool PrepackGemmWeight(Graph* graph, Node* node) {
+    if (!node->trans_b()) return false;
+    Value* packed = PrepackInitializer(graph, node->input(1), {1, 0});
+    if (!packed) return false;
+    GraphBuilder gb(graph, "SimplifyGemmPrepack", node->output(0));
+    std::vector<Value*> inputs = node->inputs();
+    inputs[1] = packed;
+    gb.Op(Node::kGemm, inputs, node->output(0))
+            ->producer()
+            ->set_alpha(node->alpha())
+            ->set_beta(node->beta())
+            ->set_trans_a(node->trans_a())
+            ->set_trans_b(false);
+    return true;
+}
+
+bool PrepackTransposedWeight(Graph* graph, Node* node) {
+    const Tensor* tensor = node->input(0)->initializer();
+    std::vector<int64_t> perm = node->perm();
+    if (tensor && perm.empty()) {
+        for (int64_t i = tensor->dims().size(); i > 0; --i) perm.push_back(i - 1);
+    }
+    Value* packed = PrepackInitializer(graph, node->input(0), perm);
+    if (!packed) return ReplaceTranspose(graph, node);
+    GraphBuilder gb(graph, "SimplifyTransposePrepack", node->output(0));
+    gb.Op(Node::kIdentity, {packed}, node->output(0));
+    return true;
+}
+
 }  // namespace
 
 void Simplify(const CompilerConfig& ccfg, Graph* graph, bool gen_backprop) {
@@ -652,6 +787,24 @@ void Simplify(const CompilerConfig& ccfg, Graph* graph, bool gen_backprop) {
     CHECK(simplifiers.emplace(Node::kShape, ReplaceShape).second);
     CHECK(simplifiers.emplace(Node::kImageScaler, ReplaceImageScaler).second);
     CHECK(simplifiers.emplace(Node::kIdentity, RemoveIdentity).second);
+    // Weights are only prepacked for inference as training updates
+    // initializers in their original layout.
+    const bool prepack = g_prepack_weights && !gen_backprop;
+    CHECK(simplifiers.emplace(Node::kTranspose, prepack ? PrepackTransposedWeight : ReplaceTranspose).second);
+    if (prepack) CHECK(simplifiers.emplace(Node::kGemm, PrepackGemmWeight).second);
+    for (Node::OpType op : {Node::kRelu,
+                            Node::kSigmoid,
+                            Node::kTanh,
+                            Node::kExp,
+                            Node::kLog,
+                            Node::kSqrt,
+                            Node::kNeg,
+                            Node::kAbs,
+                            Node::kFloor,
+                            Node::kCeil,
+                            Node::kReciprocal}) {
+        CHECK(simplifiers.emplace(op, SwapTransposeAndUnary).second);
+    }
 
     auto replace_if_not_supported = [&ccfg, &simplifiers](Node::OpType op, SimplifierFn fn) {
         if (!ccfg.HasOp(op)) {
@@ -6,6 +6,7 @@
 #include <sstream>
 
 #include <common/log.h>
+#include <common/mapped_file.h>
 #include <compiler/serializer_util.h>
 
 namespace chainer_compiler {
@@ -83,6 +84,9 @@ void DumpDataToRepeated(const Tensor& t, ::google::protobuf::RepeatedField<To>*
     DumpDataToRepeated<To, To>(t, a);
 }
 
+void NoFree(void*) noexcept {
+}
+
 }  // namespace
 
 Tensor::Tensor(const onnx::TensorProto& xtensor)
@@ -93,7 +97,9 @@ Tensor::Tensor(const onnx::TensorProto& xtensor)
       doc_string_(xtensor.doc_string()) {
     CHECK(!xtensor.has_segment()) << "Segmented TensorProto not supported";
 
-    if (xtensor.has_raw_data()) {
+    if (xtensor.data_location() == onnx::TensorProto::EXTERNAL) {
+        LoadExternalData(xtensor);
+    } else if (xtensor.has_raw_data()) {
         CHECK_EQ(0, xtensor.float_data_size());
         CHECK_EQ(0, xtensor.int32_data_size());
         CHECK_EQ(0, xtensor.string_data_size());
@@ -168,6 +174,46 @@ Tensor::Tensor(const std::string& name, Dtype dtype, const std::vector<int64_t>&
 Tensor::~Tensor() {
 }
 
+void Tensor::LoadExternalData(const onnx::TensorProto& xtensor) {
+    std::string location;
+    int64_t offset = 0;
+    int64_t length = -1;
+    for (const onnx::StringStringEntryProto& entry : xtensor.external_data()) {
+        if (entry.key() == "location") {
+            location = entry.value();
+        } else if (entry.key() == "offset") {
+            offset = std::stoll(entry.value());
+        } else if (entry.key() == "length") {
+            length = std::stoll(entry.value());
+        }
+    }
+    CHECK(!location.empty()) << "No location for external data: " << name_;
+    const int64_t num_bytes = NumElements() * ElementSize();
+    CHECK_LE(0, num_bytes) << "External data with unknown shape: " << name_;
+    if (length >= 0) CHECK_EQ(num_bytes, length) << "Invalid length of external data: " << name_;
+
+    std::shared_ptr<const MappedFile> file = MapFile(location);
+    CHECK_LE(offset + num_bytes, file->size()) << "External data out of range: " << name_ << " in " << location;
+    char* data = file->data() + offset;
+    if (reinterpret_cast<uintptr_t>(data) % ElementSize()) {
+        // Misaligned data cannot be used in place.
+        data_.reset(std::malloc(num_bytes));
+        std::memcpy(data_.get(), data, num_bytes);
+        return;
+    }
+    data_ = UniqueData(data, &NoFree);
+    mapping_ = file;
+}
+
+std::shared_ptr<void> Tensor::GetSharedData() const {
+    if (!mapping_) return nullptr;
+    // `mapping_` is shared and read-only, so hand out another mapping
+    // of only this tensor which can be updated in place by its user.
+    const int64_t offset = mapping_->offset() + (static_cast<const char*>(data_.get()) - mapping_->data());
+    std::shared_ptr<MappedFile> file = MapFilePrivate(mapping_->filename(), offset, NumElements() * ElementSize());
+    return std::shared_ptr<void>(file, file->data());
+}
+
 void Tensor::ToONNX(onnx::TensorProto* xtensor) const {
     for (int64_t d : dims_) xtensor->add_dims(d);
     xtensor->set_data_type(dtype_.ToONNX());
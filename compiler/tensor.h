@@ -8,6 +8,7 @@
 #include <compiler/onnx.h>
 
 #include <common/log.h>
+#include <common/mapped_file.h>
 #include <compiler/dtype.h>
 
 namespace chainer_compiler {
@@ -64,10 +65,20 @@ public:
         return data_.get();
     }
 
+    // Returns a new private writable mapping of only the data of an
+    // external-data tensor. Unwritten pages are shared with the file,
+    // so the data can be used without copies. Returns nullptr for
+    // tensors which own their data.
+    std::shared_ptr<void> GetSharedData() const;
+
 private:
+    void LoadExternalData(const onnx::TensorProto& xtensor);
+
     std::vector<int64_t> dims_;
     Dtype dtype_;
     UniqueData data_;
+    // A read-only memory-mapped file which `data_` points to, if any.
+    std::shared_ptr<const MappedFile> mapping_;
     std::string name_;
     std::string doc_string_;
 };
@@ -1,3 +1,5 @@
+#include <cstdio>
+#include <fstream>
 #include <string>
 
 #include <gtest/gtest.h>
@@ -43,5 +45,43 @@ TEST(TensorTest, Constructor) {
     }
 }
 
+TEST(TensorTest, ExternalData) {
+    const std::string filename = "tensor_test_external_data.bin";
+    {
+        std::ofstream ofs(filename, std::ios::binary);
+        const float values[] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f};
+        ofs.write(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+
+    onnx::TensorProto xtensor;
+    xtensor.set_name("foo");
+    xtensor.set_data_type(onnx::TensorProto::FLOAT);
+    xtensor.add_dims(2);
+    xtensor.set_data_location(onnx::TensorProto::EXTERNAL);
+    const std::pair<std::string, std::string> entries[] = {{"location", filename}, {"offset", "8"}, {"length", "8"}};
+    for (const auto& p : entries) {
+        onnx::StringStringEntryProto* entry = xtensor.add_external_data();
+        entry->set_key(p.first);
+        entry->set_value(p.second);
+    }
+
+    {
+        Tensor tensor(xtensor);
+        EXPECT_EQ(2.0, tensor.Get<float>(0));
+        EXPECT_EQ(3.0, tensor.Get<float>(1));
+        std::shared_ptr<void> data = tensor.GetSharedData();
+        ASSERT_TRUE(data);
+        EXPECT_NE(tensor.GetRawData(), data.get());
+        float* values = static_cast<float*>(data.get());
+        EXPECT_EQ(2.0, values[0]);
+        EXPECT_EQ(3.0, values[1]);
+        // Writes to the shared data are private to it.
+        values[0] = 42.0;
+        EXPECT_EQ(2.0, tensor.Get<float>(0));
+        EXPECT_EQ(2.0, static_cast<float*>(tensor.GetSharedData().get())[0]);
+    }
+    std::remove(filename.c_str());
+}
+
 }  // namespace
 }  // namespace chainer_compiler
@@ -56,6 +56,8 @@ public:
         CHECK(op_set_.emplace(Node::kNeg).second);
         CHECK(op_set_.emplace(Node::kNot).second);
         CHECK(op_set_.emplace(Node::kOneHot).second);
+        CHECK(op_set_.emplace(Node::kChainerAccumulateGrads).second);
+        CHECK(op_set_.emplace(Node::kChainerAdamUpdate).second);
         CHECK(op_set_.emplace(Node::kChainerAveragePoolGrad).second);
         CHECK(op_set_.emplace(Node::kChainerBatchNormalizationGrad).second);
         CHECK(op_set_.emplace(Node::kChainerConvGradWeight).second);
@@ -72,6 +74,7 @@ public:
         CHECK(op_set_.emplace(Node::kChainerLRNGrad).second);
         CHECK(op_set_.emplace(Node::kChainerLSTMGrad).second);
         CHECK(op_set_.emplace(Node::kChainerMaxPoolGrad).second);
+        CHECK(op_set_.emplace(Node::kChainerMomentumSGDUpdate).second);
         CHECK(op_set_.emplace(Node::kChainerNullConstant).second);
         CHECK(op_set_.emplace(Node::kChainerPrint).second);
         CHECK(op_set_.emplace(Node::kChainerReduceSumTo).second);
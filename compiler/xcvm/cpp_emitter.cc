@@ -0,0 +1,351 @@
+#include "compiler/xcvm/cpp_emitter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <common/log.h>
+#include <common/strutil.h>
+#include <compiler/code_emitter.h>
+#include <compiler/gen_xcvm_codegen.h>
+#include <runtime/xcvm.h>
+#include <runtime/xcvm.pb.h>
+
+namespace chainer_compiler {
+namespace xcvm {
+namespace {
+
+using runtime::XCInstructionProto;
+using runtime::XCProgramProto;
+
+std::string ArrayVar(int id) {
+    return StrCat("v", id);
+}
+
+std::string OpaqueVar(int id) {
+    return StrCat("o", id);
+}
+
+std::string ScalarVar(int id) {
+    return StrCat("s", id);
+}
+
+// Quotes `s` as a C++ string literal. Braces are escaped too so they
+// do not confuse the indentation of CodeEmitter.
+std::string Quote(const std::string& s) {
+    std::ostringstream oss;
+    oss << '"';
+    for (unsigned char c : s) {
+        if (std::isprint(c) && c != '"' && c != '\\' && c != '{' && c != '}') {
+            oss << c;
+        } else {
+            oss << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        }
+    }
+    oss << '"';
+    return oss.str();
+}
+
+// Removes characters which break a line comment or the indentation
+// of CodeEmitter.
+std::string Comment(const std::string& s) {
+    std::string o;
+    for (char c : s) o += (c == '\n' || c == '{' || c == '}') ? ' ' : c;
+    return o;
+}
+
+bool IsArrayListOutput(const XCVMOpSignature& sig) {
+    return sig.outputs.size() == 1 && sig.outputs[0] == "ARRAY_LIST";
+}
+
+class CppEmitter {
+public:
+    explicit CppEmitter(const XCProgramProto& program) : program_(program) {
+        for (const XCInstructionProto& inst : program_.instructions()) {
+            const XCVMOpSignature& sig = GetXCVMOpSignature(inst.op());
+            const bool is_list = IsArrayListOutput(sig);
+            if (!is_list) CHECK_EQ(sig.outputs.size(), inst.outputs_size()) << inst.DebugString();
+            for (int i = 0; i < inst.outputs_size(); ++i) {
+                const int id = inst.outputs(i);
+                if (id < 0) continue;
+                num_variables_ = std::max(num_variables_, id + 1);
+                const std::string& type = is_list ? "ARRAY" : sig.outputs[i];
+                CHECK_NE("SEQUENCE", type) << "AOT compilation does not support sequences: " << inst.DebugString();
+                if (type == "OPAQUE") {
+                    opaques_.insert(id);
+                } else if (type == "SCALAR") {
+                    scalars_.insert(id);
+                } else {
+                    arrays_.insert(id);
+                }
+            }
+            if (inst.op() == XCInstructionProto::Jmp) {
+                jump_targets_.insert(inst.inputs(0).i());
+            } else if (
+                    inst.op() == XCInstructionProto::JmpTrue || inst.op() == XCInstructionProto::JmpFalse ||
+                    inst.op() == XCInstructionProto::ScalarJmpTrue || inst.op() == XCInstructionProto::ScalarJmpFalse) {
+                jump_targets_.insert(inst.inputs(1).i());
+            }
+        }
+    }
+
+    void EmitHeader(const std::string& name, std::ostream& out) {
+        CodeEmitter ce(out);
+        ce << "// Auto-generated by chainer-compiler\n\n";
+        ce << "#pragma once\n\n";
+        ce << "#include <runtime/xcvm.h>\n\n";
+        ce << "chainer_compiler::runtime::InOuts " << name << "(\n";
+        ce << "        const chainer_compiler::runtime::InOuts& inputs, const chainer_compiler::runtime::XCVMOptions& options);\n";
+    }
+
+    void EmitSource(const std::string& name, const std::string& header_path, std::ostream& out) {
+        CodeEmitter ce(out);
+        ce << "// Auto-generated by chainer-compiler\n\n";
+        ce << "#include " << Quote(header_path) << "\n\n";
+        ce << "#include <memory>\n";
+        ce << "#include <tuple>\n";
+        ce << "#include <vector>\n\n";
+        ce << "#include <chainerx/array.h>\n\n";
+        ce << "#include <common/log.h>\n";
+        ce << "#include <runtime/gen_xcvm_ops.h>\n";
+        ce << "#include <runtime/xcvm.pb.h>\n";
+        ce << "#include <runtime/xcvm_state.h>\n";
+        ce << "#include <runtime/xcvm_var.h>\n\n";
+        ce << "using namespace chainer_compiler::runtime;\n\n";
+        ce.EmitWithoutIndent("namespace {\n\n");
+
+        // Ops are constructed from the embedded program so their
+        // attributes are initialized exactly as in the interpreter.
+        std::string serialized;
+        CHECK(program_.SerializeToString(&serialized));
+        ce << "const unsigned char kProgram[] = {";
+        for (size_t i = 0; i < serialized.size(); ++i) {
+            if (i % 16 == 0) ce << "\n";
+            ce << static_cast<int>(static_cast<unsigned char>(serialized[i])) << ",";
+        }
+        // A trailing zero keeps the array non-empty for empty programs.
+        ce << "\n0};\n\n";
+
+        ce << "chainerx::Array GetInput(const InOuts& inputs, const char* name) {\n";
+        ce << "auto found = inputs.find(name);\n";
+        ce << "CHECK(found != inputs.end()) << \"Input value not exist: \" << name;\n";
+        ce << "if (found->second->IsNull()) return chainerx::Array();\n";
+        ce << "return found->second->GetArray();\n";
+        ce << "}\n\n";
+
+        // Null values of the interpreter are represented by arrays
+        // without bodies.
+        ce << "bool IsNull(const chainerx::Array& a) {\n";
+        ce << "return chainerx::internal::GetArrayBody(a) == nullptr;\n";
+        ce << "}\n\n";
+
+        ce << "std::shared_ptr<XCVMVar> ToVar(const chainerx::Array& a) {\n";
+        ce << "return IsNull(a) ? std::make_shared<XCVMVar>() : std::make_shared<XCVMVar>(a);\n";
+        ce << "}\n\n";
+
+        ce << "const std::vector<std::unique_ptr<XCVMOp>>& GetOps() {\n";
+        ce << "static const std::vector<std::unique_ptr<XCVMOp>>* ops = [] {\n";
+        ce << "XCProgramProto program;\n";
+        ce << "CHECK(program.ParseFromArray(kProgram, sizeof(kProgram) - 1));\n";
+        ce << "auto* ops = new std::vector<std::unique_ptr<XCVMOp>>();\n";
+        ce << "for (const XCInstructionProto& inst : program.instructions()) ops->emplace_back(MakeXCVMOp(inst));\n";
+        ce << "return ops;\n";
+        ce << "}();\n";
+        ce << "return *ops;\n";
+        ce << "}\n\n";
+
+        ce << "static inline InOuts Run(const InOuts& inputs, const XCVMOptions& options) {\n";
+        ce << "const std::vector<std::unique_ptr<XCVMOp>>& ops = GetOps();\n";
+        ce << "// Values live in locals, but the state has as many slots as the\n";
+        ce << "// interpreter's in case a kernel looks at them.\n";
+        ce << "XCVMState st(options, " << num_variables_ << ", inputs);\n";
+        ce << "InOuts outputs;\n";
+        for (int id : arrays_) ce << "chainerx::Array " << ArrayVar(id) << ";\n";
+        for (int id : opaques_) ce << "std::unique_ptr<XCVMOpaque> " << OpaqueVar(id) << ";\n";
+        for (int id : scalars_) ce << "int64_t " << ScalarVar(id) << " = 0;\n";
+        ce << "\n";
+        for (int pc = 0; pc < program_.instructions_size(); ++pc) {
+            if (jump_targets_.count(pc)) ce << "L" << pc << ":\n";
+            EmitInstruction(pc, program_.instructions(pc), &ce);
+        }
+        if (jump_targets_.count(program_.instructions_size())) ce << "L" << program_.instructions_size() << ":\n";
+        ce << "return outputs;\n";
+        ce << "}\n\n";
+        ce.EmitWithoutIndent("}  // namespace\n\n");
+
+        ce << "InOuts " << name << "(const InOuts& inputs, const XCVMOptions& options) {\n";
+        ce << "return Run(inputs, options);\n";
+        ce << "}\n\n";
+        ce << "extern \"C\" void " << runtime::kAOTEntryPointName << "(const InOuts& inputs, const XCVMOptions& options, InOuts* outputs) {\n";
+        ce << "*outputs = Run(inputs, options);\n";
+        ce << "}\n";
+    }
+
+private:
+    std::string Array(int id) const {
+        CHECK(arrays_.count(id)) << "Use of an undefined array: $" << id;
+        return ArrayVar(id);
+    }
+
+    std::string Scalar(int id) const {
+        CHECK(scalars_.count(id)) << "Use of an undefined scalar: %" << id;
+        return ScalarVar(id);
+    }
+
+    void EmitInstruction(int pc, const XCInstructionProto& inst, CodeEmitter* ce) {
+        const XCVMOpSignature& sig = GetXCVMOpSignature(inst.op());
+        const std::string& op_name = XCInstructionProto::Op_Name(inst.op());
+        if (!inst.debug_info().empty()) *ce << "// " << Comment(inst.debug_info()) << "\n";
+
+        switch (inst.op()) {
+            case XCInstructionProto::In:
+                *ce << ArrayVar(inst.outputs(0)) << " = GetInput(inputs, " << Quote(inst.inputs(0).s()) << ");\n";
+                return;
+            case XCInstructionProto::Out:
+                *ce << "outputs.emplace(" << Quote(inst.inputs(0).s()) << ", ToVar(" << Array(inst.inputs(1).array()) << "));\n";
+                return;
+            case XCInstructionProto::Free: {
+                const int id = inst.inputs(0).array();
+                if (opaques_.count(id)) {
+                    *ce << OpaqueVar(id) << ".reset();\n";
+                } else {
+                    *ce << Array(id) << " = chainerx::Array();\n";
+                }
+                return;
+            }
+            case XCInstructionProto::Identity:
+                *ce << ArrayVar(inst.outputs(0)) << " = " << Array(inst.inputs(0).array()) << ";\n";
+                return;
+            case XCInstructionProto::Jmp:
+                *ce << "goto L" << inst.inputs(0).i() << ";\n";
+                return;
+            case XCInstructionProto::JmpTrue:
+            case XCInstructionProto::JmpFalse:
+                *ce << "if (" << (inst.op() == XCInstructionProto::JmpFalse ? "!" : "") << "static_cast<bool>(chainerx::AsScalar("
+                    << Array(inst.inputs(0).array()) << "))) goto L" << inst.inputs(1).i() << ";\n";
+                return;
+            case XCInstructionProto::ScalarJmpTrue:
+            case XCInstructionProto::ScalarJmpFalse:
+                *ce << "if (" << (inst.op() == XCInstructionProto::ScalarJmpFalse ? "!" : "") << Scalar(inst.inputs(0).scalar()) << ") goto L"
+                    << inst.inputs(1).i() << ";\n";
+                return;
+            default:
+                break;
+        }
+        CHECK(sig.typed) << "AOT compilation does not support " << op_name;
+
+        std::vector<std::string> args = {"&st"};
+        for (int i = 0; i < inst.inputs_size(); ++i) {
+            const runtime::XCValueProto& value = inst.inputs(i);
+            const std::string& type = sig.inputs[i];
+            if (type == "ARRAY") {
+                args.push_back(Array(value.array()));
+            } else if (type == "OPTIONAL_ARRAY") {
+                args.push_back(value.array() < 0 ? "nonstd::nullopt" : StrCat("nonstd::optional<chainerx::Array>(", Array(value.array()), ")"));
+            } else if (type == "ARRAY_LIST") {
+                std::vector<std::string> arrays;
+                for (int id : value.array_list()) arrays.push_back(Array(id));
+                args.push_back(StrCat("std::vector<chainerx::Array>{", JoinString(arrays), "}"));
+            } else if (type == "OPAQUE") {
+                CHECK(opaques_.count(value.opaque())) << "Use of an undefined opaque: *" << value.opaque();
+                args.push_back(StrCat("*", OpaqueVar(value.opaque())));
+            } else if (type == "SCALAR") {
+                args.push_back(Scalar(value.scalar()));
+            } else {
+                CHECK_NE("SEQUENCE", type) << "AOT compilation does not support sequences: " << inst.DebugString();
+            }
+        }
+        const std::string call =
+                StrCat("static_cast<", op_name, "Op*>(ops[", pc, "].get())->RunImpl(", JoinString(args), ")");
+
+        // Skip the op if an input is null, as the interpreter does.
+        std::vector<std::string> null_conds;
+        for (int i = 0; i < inst.inputs_size(); ++i) {
+            const std::string& type = sig.inputs[i];
+            const int id = inst.inputs(i).array();
+            if ((type == "ARRAY" || type == "OPTIONAL_ARRAY") && id >= 0) {
+                null_conds.push_back(StrCat("IsNull(", Array(id), ")"));
+            } else if (type == "OPAQUE") {
+                null_conds.push_back(StrCat("!", OpaqueVar(inst.inputs(i).opaque())));
+            }
+        }
+        if (!null_conds.empty()) {
+            *ce << "if (" << JoinString(null_conds, " || ") << ") {\n";
+            *ce << "WARN_ONCE(" << Quote(op_name + " skipped") << ");\n";
+            if (!IsArrayListOutput(sig)) {
+                for (int i = 0; i < inst.outputs_size(); ++i) {
+                    const int id = inst.outputs(i);
+                    if (id < 0) continue;
+                    if (sig.outputs[i] == "ARRAY" || sig.outputs[i] == "OPTIONAL_ARRAY") {
+                        *ce << ArrayVar(id) << " = chainerx::Array();\n";
+                    } else if (sig.outputs[i] == "OPAQUE") {
+                        *ce << OpaqueVar(id) << ".reset();\n";
+                    }
+                }
+            }
+            *ce << "} else {\n";
+        }
+
+        auto assign = [ce](const std::string& type, int id, const std::string& rhs) {
+            if (type == "OPAQUE") {
+                *ce << OpaqueVar(id) << ".reset(" << rhs << ");\n";
+            } else if (type == "SCALAR") {
+                *ce << ScalarVar(id) << " = " << rhs << ";\n";
+            } else {
+                *ce << ArrayVar(id) << " = " << rhs << ";\n";
+            }
+        };
+
+        if (inst.outputs_size() == 0) {
+            *ce << call << ";\n";
+        } else if (IsArrayListOutput(sig)) {
+            *ce << "{\n";
+            *ce << "std::vector<chainerx::Array> r = " << call << ";\n";
+            *ce << "CHECK_EQ(" << inst.outputs_size() << ", r.size());\n";
+            for (int i = 0; i < inst.outputs_size(); ++i) *ce << ArrayVar(inst.outputs(i)) << " = r[" << i << "];\n";
+            *ce << "}\n";
+        } else if (inst.outputs_size() == 1) {
+            assign(sig.outputs[0], inst.outputs(0), call);
+        } else {
+            *ce << "{\n";
+            *ce << "auto r = " << call << ";\n";
+            for (int i = 0; i < inst.outputs_size(); ++i) {
+                const std::string rhs = StrCat("std::get<", i, ">(r)");
+                if (inst.outputs(i) >= 0) {
+                    assign(sig.outputs[i], inst.outputs(i), rhs);
+                } else if (sig.outputs[i] == "OPAQUE") {
+                    *ce << "delete " << rhs << ";\n";
+                }
+            }
+            *ce << "}\n";
+        }
+
+        if (!null_conds.empty()) *ce << "}\n";
+    }
+
+    const XCProgramProto& program_;
+    std::set<int> arrays_;
+    std::set<int> opaques_;
+    std::set<int> scalars_;
+    std::set<int> jump_targets_;
+    int num_variables_ = 0;
+};
+
+}  // namespace
+
+void EmitCpp(
+        const runtime::XCProgramProto& program,
+        const std::string& name,
+        const std::string& header_path,
+        std::ostream& header,
+        std::ostream& source) {
+    CppEmitter emitter(program);
+    emitter.EmitHeader(name, header);
+    emitter.EmitSource(name, header_path, source);
+}
+
+}  // namespace xcvm
+}  // namespace chainer_compiler
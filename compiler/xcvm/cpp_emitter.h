@@ -0,0 +1,27 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+namespace chainer_compiler {
+
+namespace runtime {
+class XCProgramProto;
+}
+
+namespace xcvm {
+
+// Translates an XCVM program into C++ which calls the runtime kernels
+// directly, keeping values in local variables. The source defines
+// `name` declared in the header and the entry point which can be
+// looked up as runtime::kAOTEntryPointName. `header_path` is used to
+// include the header from the source.
+void EmitCpp(
+        const runtime::XCProgramProto& program,
+        const std::string& name,
+        const std::string& header_path,
+        std::ostream& header,
+        std::ostream& source);
+
+}  // namespace xcvm
+}  // namespace chainer_compiler
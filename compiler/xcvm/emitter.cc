@@ -1,5 +1,6 @@
 #include "compiler/xcvm/emitter.h"
 
+#include <algorithm>
 #include <map>
 
 #include <common/log.h>
@@ -53,6 +54,24 @@ std::vector<int> ComplementStrideOrPad(const std::vector<int>& orig, const Value
     return filled;
 }
 
+// Normalizes a negative axis for statically known rank so the runtime
+// does not need to.
+int NormalizeAxis(int axis, const Value* input) {
+    const Type& type = input->type();
+    if (axis >= 0 || type.kind() != Type::Kind::kTensor || !type.HasKnownShape()) {
+        return axis;
+    }
+    axis += type.ndim();
+    CHECK_LE(0, axis) << type.DebugString();
+    return axis;
+}
+
+std::vector<int> NormalizeAxes(const std::vector<int>& axes, const Value* input) {
+    std::vector<int> normalized;
+    for (int axis : axes) normalized.push_back(NormalizeAxis(axis, input));
+    return normalized;
+}
+
 void FillOpInfo(const Node& node, const std::string& debug_info, XCProgramProto* prog) {
     runtime::XCInstructionProto* inst = prog->mutable_instructions(prog->instructions_size() - 1);
     inst->set_debug_info(debug_info);
@@ -68,6 +87,9 @@ public:
         AssignValueIds(graph);
         EmitGraph(graph, program, false /* in_loop */, graph.output_values());
         EmitOutputs(graph.output_values(), program);
+        if (g_compiler_log) {
+            CLOG() << "Elided " << num_elided_instructions_ << " instructions for constant shapes and identities" << std::endl;
+        }
         if (dump_value_names) {
             std::map<int, const Value*> values;
             for (auto p : value_ids_) {
@@ -345,15 +367,33 @@ private:
         } else if (node.op_type() == Node::kShape) {
             CHECK_EQ(1UL, node.inputs().size());
             CHECK_EQ(1UL, node.outputs().size());
-            EMIT(Shape, out(0), in(0));
+            // Only shapes of constants are baked. Inferred shapes of
+            // other values may not match the runtime (e.g., batch size).
+            if (const Tensor* tensor = GetConstantTensor(node.input(0))) {
+                const std::vector<int64_t>& dims = tensor->dims();
+                EMIT(IntConstant, out(0), dims, Dtype::kInt64, std::vector<int>{static_cast<int>(dims.size())}, true);
+            } else {
+                EMIT(Shape, out(0), in(0));
+            }
         } else if (node.op_type() == Node::kSize) {
             CHECK_EQ(1UL, node.inputs().size());
             CHECK_EQ(1UL, node.outputs().size());
-            EMIT(Size, out(0), in(0));
+            if (const Tensor* tensor = GetConstantTensor(node.input(0))) {
+                EMIT(IntConstant, out(0), std::vector<int64_t>{tensor->NumElements()}, Dtype::kInt64, std::vector<int>{}, true);
+            } else {
+                EMIT(Size, out(0), in(0));
+            }
         } else if (node.op_type() == Node::kReshape) {
             CHECK_EQ(2UL, node.inputs().size());
             CHECK_EQ(1UL, node.outputs().size());
-            EMIT(Reshape, out(0), in(0), in(1));
+            if (folded_values_.count(node.input(1))) {
+                const Tensor* shape = GetConstantTensor(node.input(1));
+                std::vector<int> dims;
+                for (int64_t i = 0; i < shape->NumElements(); ++i) dims.push_back(shape->Get<int64_t>(i));
+                EMIT(StaticReshape, out(0), in(0), dims);
+            } else {
+                EMIT(Reshape, out(0), in(0), in(1));
+            }
         } else if (node.op_type() == Node::kExpand) {
             CHECK_EQ(2UL, node.inputs().size());
             CHECK_EQ(1UL, node.outputs().size());
@@ -425,9 +465,7 @@ private:
             CHECK_EQ(1UL, node.inputs().size());
             CHECK_EQ("NOTSET", node.auto_pad()) << "auto_pad is not supported for MaxPool";
             if (node.outputs().size() == 1) {
-                int tmp_id = next_value_id_++;
-                EMIT(MaxPool, out(0), tmp_id, in(0), IntVector(node.kernel_shape()), strides(), pads(), node.chainer_cover_all());
-                FREE(tmp_id);
+                EMIT(MaxPool, out(0), -1, in(0), IntVector(node.kernel_shape()), strides(), pads(), node.chainer_cover_all());
             } else {
                 CHECK_EQ(3UL, node.outputs().size());
                 CHECK(node.output(1)->IsNull());
@@ -437,9 +475,7 @@ private:
             CHECK_EQ("NOTSET", node.auto_pad()) << "auto_pad is not supported for AveragePool";
             CHECK_EQ(1UL, node.inputs().size());
             if (node.outputs().size() == 1) {
-                int tmp_id = next_value_id_++;
-                EMIT(AveragePool, out(0), tmp_id, in(0), IntVector(node.kernel_shape()), strides(), pads(), node.count_include_pad());
-                FREE(tmp_id);
+                EMIT(AveragePool, out(0), -1, in(0), IntVector(node.kernel_shape()), strides(), pads(), node.count_include_pad());
             } else {
                 CHECK_EQ(2UL, node.outputs().size());
                 EMIT(AveragePool, out(0), out(1), in(0), IntVector(node.kernel_shape()), strides(), pads(), node.count_include_pad());
@@ -514,23 +550,23 @@ private:
             } else {
                 CHECK_EQ(node.starts().size(), axes.size());
             }
-            EMIT(Slice, out(0), in(0), axes, IntVector(node.starts()), IntVector(node.ends()));
+            EMIT(Slice, out(0), in(0), NormalizeAxes(axes, node.input(0)), IntVector(node.starts()), IntVector(node.ends()));
         } else if (node.op_type() == Node::kDynamicSlice) {
             EMIT(DynamicSlice, out(0), in(0), in(1), in(2), oin(3));
         } else if (node.op_type() == Node::kGather) {
             CHECK_EQ(2UL, node.inputs().size());
             CHECK_EQ(1UL, node.outputs().size());
-            EMIT(Gather, out(0), in(0), in(1), node.axis());
+            EMIT(Gather, out(0), in(0), in(1), NormalizeAxis(node.axis(), node.input(0)));
         } else if (node.op_type() == Node::kConcat) {
             CHECK_EQ(1UL, node.outputs().size());
             std::vector<int> ins;
             for (size_t i = 0; i < node.inputs().size(); ++i) ins.push_back(in(i));
-            EMIT(Concat, out(0), ins, node.axis());
+            EMIT(Concat, out(0), ins, NormalizeAxis(node.axis(), node.input(0)));
         } else if (node.op_type() == Node::kSplit) {
             CHECK_EQ(1UL, node.inputs().size());
             std::vector<XCVMValue> outs;
             for (size_t i = 0; i < node.outputs().size(); ++i) outs.push_back(out(i));
-            EMIT(Split, outs, in(0), node.axis(), IntVector(node.split()));
+            EMIT(Split, outs, in(0), NormalizeAxis(node.axis(), node.input(0)), IntVector(node.split()));
         } else if (node.op_type() == Node::kClip) {
             CHECK_EQ(1UL, node.inputs().size());
             CHECK_EQ(1UL, node.outputs().size());
@@ -576,6 +612,39 @@ private:
             std::vector<int> ins;
             for (size_t i = 0; i < node.inputs().size(); ++i) ins.push_back(in(i));
             EMIT(Print, ins);
+        } else if (node.op_type() == Node::kChainerAccumulateGrads) {
+            CHECK_EQ(0, node.inputs().size() % 2) << node.ToString();
+            const size_t num_grads = node.inputs().size() / 2;
+            std::vector<int> accums, grads;
+            for (size_t i = 0; i < num_grads; ++i) {
+                accums.push_back(in(i));
+                grads.push_back(in(num_grads + i));
+            }
+            EMIT(AccumulateGrads, accums, grads);
+        } else if (node.op_type() == Node::kChainerMomentumSGDUpdate) {
+            const int num_lists = node.momentum() == 0 ? 2 : 3;
+            CHECK_EQ(0, (node.inputs().size() - 2) % num_lists) << node.ToString();
+            const size_t num_params = (node.inputs().size() - 2) / num_lists;
+            std::vector<std::vector<int>> lists(3);
+            for (size_t i = 0; i < num_params * num_lists; ++i) lists[i / num_params].push_back(in(2 + i));
+            EMIT(MomentumSGDUpdate, in(0), in(1), lists[0], lists[1], lists[2], node.momentum(), node.weight_decay());
+        } else if (node.op_type() == Node::kChainerAdamUpdate) {
+            CHECK_EQ(0, (node.inputs().size() - 3) % 4) << node.ToString();
+            const size_t num_params = (node.inputs().size() - 3) / 4;
+            std::vector<std::vector<int>> lists(4);
+            for (size_t i = 0; i < num_params * 4; ++i) lists[i / num_params].push_back(in(3 + i));
+            EMIT(AdamUpdate,
+                 in(0),
+                 in(1),
+                 in(2),
+                 lists[0],
+                 lists[1],
+                 lists[2],
+                 lists[3],
+                 node.beta1(),
+                 node.beta2(),
+                 node.epsilon(),
+                 node.weight_decay());
         } else if (node.op_type() == Node::kChainerSequenceCreate) {
             EMIT(SequenceCreate, out(0));
         } else if (node.op_type() == Node::kChainerSequenceSize) {
@@ -603,7 +672,12 @@ private:
                 EMIT(SequencePop, out(1), o0.id());
             }
         } else if (node.op_type() == Node::kChainerSequenceLookup) {
-            EMIT(SequenceLookup, out(0), in(0), in(1));
+            auto found = scalar_ids_.find(node.input(1));
+            if (found != scalar_ids_.end()) {
+                EMIT(SequenceLookupScalar, out(0), in(0), found->second);
+            } else {
+                EMIT(SequenceLookup, out(0), in(0), in(1));
+            }
         } else if (node.op_type() == Node::kChainerSequenceGetSlice) {
             EMIT(SequenceGetSlice, out(0), in(0), oin(1), oin(2), oin(3));
         } else if (node.op_type() == Node::kChainerSequenceLookupGrad) {
@@ -633,7 +707,12 @@ private:
         } else if (node.op_type() == Node::kChainerGenericLen) {
             EMIT(GenericLen, out(0), in(0));
         } else if (node.op_type() == Node::kChainerGenericGetItem) {
-            EMIT(GenericGetItem, out(0), in(0), in(1));
+            auto found = scalar_ids_.find(node.input(1));
+            if (found != scalar_ids_.end()) {
+                EMIT(GenericGetItemScalar, out(0), in(0), found->second);
+            } else {
+                EMIT(GenericGetItem, out(0), in(0), in(1));
+            }
         } else if (node.op_type() == Node::kChainerGenericGetSlice) {
             EMIT(GenericGetSlice, out(0), in(0), oin(1), oin(2), oin(3));
         } else if (node.op_type() == Node::kChainerGenericAdd) {
@@ -742,12 +821,41 @@ private:
                 for (const Value* value : node->inputs()) {
                     if (!value->IsInput()) continue;
                     if (!staged_inputs.emplace(value).second) continue;
+                    if (IsFoldableReshapeShape(value)) {
+                        folded_values_.insert(value);
+                        ++num_elided_instructions_;
+                        continue;
+                    }
                     AddInOp(prog, GetValueId(value), value->name());
                     prog->mutable_instructions(prog->instructions_size() - 1)->set_debug_info(value->name());
                 }
             }
 
-            EmitNode(&graph, *node, prog);
+            if (node->op_type() == Node::kConstant && IsFoldableReshapeShape(node->output(0))) {
+                // The value will be embedded in `StaticReshape`.
+                folded_values_.insert(node->output(0));
+                ++num_elided_instructions_;
+                continue;
+            }
+
+            // An Identity whose input dies here does not need its own
+            // variable slot. Let the output share the input's.
+            bool aliased = false;
+            if (node->op_type() == Node::kIdentity) {
+                const Value* input = node->input(0);
+                const Value* output = node->output(0);
+                auto found = num_users.find(input);
+                if (found != num_users.end() && found->second == 1 && input->IsTemp() && !input->IsNull() && output->IsTemp() &&
+                    !output->IsNull() && !todo_outputs.count(output)) {
+                    value_ids_[output] = GetValueId(input);
+                    aliased = true;
+                    ++num_elided_instructions_;
+                }
+            }
+
+            if (!aliased) {
+                EmitNode(&graph, *node, prog);
+            }
 
             for (const Value* output : node->outputs()) {
                 // Do not free output values.
@@ -762,6 +870,9 @@ private:
                 auto found = num_users.find(input);
                 if (found == num_users.end()) continue;
                 if (--found->second == 0) {
+                    // The slot was taken over by the output.
+                    if (aliased) continue;
+                    if (folded_values_.count(input)) continue;
                     FREE(GetValueId(input));
                 }
             }
@@ -970,11 +1081,20 @@ private:
         prog->mutable_instructions(prog->instructions_size() - 1)->set_debug_info(StrCat(debug_info, " @", __LINE__)); \
     } while (0)
 
-        // Initialize loop variables.
-        int iter_id = GetValueId(body_input_values[0]);
-        EMIT(IntScalarConstant, iter_id, 0, Dtype::kInt64, true);
-        int cond_id = GetValueId(body_input_values[1]);
-        EMIT(IntScalarConstant, cond_id, 1, Dtype::kBool, true);
+        // The iteration count and the condition live in scalar
+        // registers. They are materialized as arrays only when the
+        // body reads them as arrays.
+        const Value* iter_value = body_input_values[0];
+        const Value* cond_value = body_input_values[1];
+        const bool iter_as_array = !IsScalarIndexOnly(iter_value, body_output_values);
+        const bool cond_as_array = !IsScalarIndexOnly(cond_value, body_output_values);
+        int iter_reg = next_value_id_++;
+        int cond_reg = next_value_id_++;
+        int one_reg = next_value_id_++;
+        int trip_reg = -1;
+        scalar_ids_[iter_value] = iter_reg;
+        EMIT(ScalarConstant, iter_reg, 0);
+        EMIT(ScalarConstant, one_reg, 1);
         for (int i = 0; i < num_states; ++i) {
             CHECK_LT(i + 2, loop.inputs().size());
             CHECK_LT(i + 2, body_input_values.size());
@@ -991,43 +1111,50 @@ private:
             scan_out_ids.push_back(id);
         }
 
-        int skip_loop_jmp = -1;
-        int skip_loop_cond_id = -1;
         if (!max_trip_count->IsNull()) {
-            int zero_id = next_value_id_++;
-            skip_loop_cond_id = next_value_id_++;
-            EMIT(IntScalarConstant, zero_id, 0, Dtype::kInt64, true);
-            EMIT(Greater, skip_loop_cond_id, GetValueId(max_trip_count), zero_id);
-            FREE(zero_id);
+            trip_reg = next_value_id_++;
+            EMIT(ScalarFromArray, trip_reg, GetValueId(max_trip_count));
+            EMIT(ScalarLess, cond_reg, iter_reg, trip_reg);
+        } else {
+            EMIT(ScalarConstant, cond_reg, 1);
         }
         if (!terminal_condition->IsNull()) {
-            int tmp_id = next_value_id_++;
-            if (skip_loop_cond_id >= 0) {
-                EMIT(Mul, tmp_id, skip_loop_cond_id, GetValueId(terminal_condition));
-                FREE(skip_loop_cond_id);
-            } else {
-                EMIT(Identity, tmp_id, GetValueId(terminal_condition));
-            }
-            skip_loop_cond_id = tmp_id;
-        }
-        if (skip_loop_cond_id >= 0) {
-            skip_loop_jmp = prog->instructions_size();
-            EMIT(JmpFalse, skip_loop_cond_id, -1);
+            int tmp_reg = next_value_id_++;
+            EMIT(ScalarFromArray, tmp_reg, GetValueId(terminal_condition));
+            EMIT(ScalarMul, cond_reg, cond_reg, tmp_reg);
         }
+        int skip_loop_jmp = prog->instructions_size();
+        EMIT(ScalarJmpFalse, cond_reg, -1);
 
         int loop_begin = prog->instructions_size();
+        if (iter_as_array) EMIT(ScalarToArray, GetValueId(iter_value), iter_reg, Dtype::kInt64);
+        if (cond_as_array) EMIT(ScalarToArray, GetValueId(cond_value), cond_reg, Dtype::kBool);
 
         EmitGraph(*body, prog, true /* in_loop */, body_output_values);
-        int one_id = next_value_id_++;
-        EMIT(IntScalarConstant, one_id, 1, Dtype::kInt64, true);
-        int tmp_id = next_value_id_++;
-        EMIT(Add, tmp_id, iter_id, one_id);
-        FREE(one_id);
+        EMIT(ScalarAdd, iter_reg, iter_reg, one_reg);
+
+        // Check if the loop finishes.
+        const Value* body_cond = body_output_values[0];
+        if (terminal_condition->IsNull()) {
+            CHECK(!max_trip_count->IsNull());
+            EMIT(ScalarLess, cond_reg, iter_reg, trip_reg);
+        } else {
+            EMIT(ScalarFromArray, cond_reg, GetValueId(body_cond));
+            if (!max_trip_count->IsNull()) {
+                int tmp_reg = next_value_id_++;
+                EMIT(ScalarLess, tmp_reg, iter_reg, trip_reg);
+                EMIT(ScalarMul, cond_reg, cond_reg, tmp_reg);
+            }
+        }
+
         for (const Value* value : body_input_values) {
+            if (value == iter_value && !iter_as_array) continue;
+            if (value == cond_value && !cond_as_array) continue;
             FREE(GetValueId(value));
         }
-        MOVE(iter_id, tmp_id);
-        MOVE(cond_id, GetValueId(body_output_values[0]));
+        if (std::find(body_input_values.begin(), body_input_values.end(), body_cond) == body_input_values.end()) {
+            FREE(GetValueId(body_cond));
+        }
 
         // Propagate the loop state.
         for (int i = 0; i < num_states; ++i) {
@@ -1051,26 +1178,10 @@ private:
             FREE(GetValueId(body_out));
         }
 
-        // Check if the loop finishes.
-        if (terminal_condition->IsNull()) {
-            CHECK(!max_trip_count->IsNull());
-            FREE(cond_id);
-            EMIT(Greater, cond_id, GetValueId(loop.input(0)), iter_id);
-        } else if (!max_trip_count->IsNull()) {
-            EMIT(Greater, tmp_id, GetValueId(loop.input(0)), iter_id);
-            int tmp2_id = next_value_id_++;
-            EMIT(Mul, tmp2_id, cond_id, tmp_id);
-            FREE(cond_id);
-            MOVE(cond_id, tmp2_id);
-            FREE(tmp_id);
-        }
-        EMIT(JmpTrue, cond_id, loop_begin);
+        EMIT(ScalarJmpTrue, cond_reg, loop_begin);
 
-        if (skip_loop_jmp >= 0) {
-            runtime::XCInstructionProto* jmp = prog->mutable_instructions(skip_loop_jmp);
-            jmp->mutable_inputs(1)->set_i(prog->instructions_size());
-            FREE(skip_loop_cond_id);
-        }
+        runtime::XCInstructionProto* jmp = prog->mutable_instructions(skip_loop_jmp);
+        jmp->mutable_inputs(1)->set_i(prog->instructions_size());
 
         // Output final states.
         for (size_t i = 0; i < num_states; ++i) {
@@ -1093,9 +1204,6 @@ private:
             FREE(scan_out_ids[i]);
         }
 
-        FREE(iter_id);
-        FREE(cond_id);
-
 #undef EMIT
     }
 
@@ -1104,6 +1212,39 @@ private:
         EmitLoopImpl(loop, loop.body().get(), loop.body()->input_values(), loop.body()->output_values(), prog);
     }
 
+    static const Tensor* GetConstantTensor(const Value* value) {
+        if (value->initializer()) return value->initializer();
+        const Node* producer = value->producer();
+        if (producer && producer->op_type() == Node::kConstant) return producer->tensor_value().get();
+        return nullptr;
+    }
+
+    // Returns true if `value` is a constant shape used only by a
+    // Reshape so it can be baked into a `StaticReshape` instruction.
+    static bool IsFoldableReshapeShape(const Value* value) {
+        if (value->IsOutput() || value->users().size() != 1) return false;
+        const Node* user = value->users()[0];
+        if (user->op_type() != Node::kReshape || user->input(1) != value) return false;
+        const Tensor* shape = GetConstantTensor(value);
+        if (!shape || shape->dtype() != Dtype::kInt64 || shape->dims().size() != 1) return false;
+        for (int64_t i = 0; i < shape->NumElements(); ++i) {
+            // Zero in a shape means copying the input dimension.
+            if (shape->Get<int64_t>(i) == 0) return false;
+        }
+        return true;
+    }
+
+    // Returns true if `value` in a loop body is only used as an index
+    // which can be read from a scalar register.
+    static bool IsScalarIndexOnly(const Value* value, const std::vector<Value*>& body_output_values) {
+        if (std::find(body_output_values.begin(), body_output_values.end(), value) != body_output_values.end()) return false;
+        for (const Node* user : value->users()) {
+            if (user->op_type() != Node::kChainerSequenceLookup && user->op_type() != Node::kChainerGenericGetItem) return false;
+            if (user->input(0) == value) return false;
+        }
+        return true;
+    }
+
     void EmitOutputs(const std::vector<Value*>& output_values, XCProgramProto* prog) {
         for (const Value* value : output_values) {
             AddOutOp(prog, value->name(), GetValueId(value));
@@ -1114,8 +1255,14 @@ private:
 
     int next_value_id_{1};
     std::map<const Value*, int> value_ids_;
+    // Scalar registers which hold the values of loop counters.
+    std::map<const Value*, int> scalar_ids_;
     std::map<int, int> stack_ids_;
     std::set<const Node*> emitted_;
+    // Constant values which are embedded in instructions instead of
+    // being materialized at runtime.
+    std::set<const Value*> folded_values_;
+    int num_elided_instructions_{0};
 };
 
 }  // namespace
@@ -3,14 +3,26 @@
 
 #include <gtest/gtest.h>
 
+#include <chainerx/array.h>
+#include <chainerx/context.h>
+#include <chainerx/numeric.h>
+#include <chainerx/routines/creation.h>
+#include <chainerx/testing/array.h>
+
 #include <compiler/onnx.h>
 
 #include <common/log.h>
 #include <common/protoutil.h>
+#include <compiler/graph.h>
+#include <compiler/graph_builder.h>
 #include <compiler/model.h>
 #include <compiler/passes.h>
+#include <compiler/scheduler.h>
+#include <compiler/xcvm/cpp_emitter.h>
 #include <compiler/xcvm/emitter.h>
+#include <runtime/xcvm.h>
 #include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_var.h>
 
 namespace chainer_compiler {
 namespace {
@@ -41,5 +53,133 @@ TEST(XCVMTest, Compile) {
     ASSERT_EQ(runtime::XCInstructionProto::Free, program.instructions(6).op());
 }
 
+TEST(XCVMTest, BakeConstantSize) {
+    Graph graph("test");
+    Value* output = graph.AddOutputValue("output", Type(Dtype::kInt64, {}));
+    {
+        GraphBuilder gb(&graph, "test", output);
+        Value* c = gb.Const(Type(Dtype::kFloat32, {3, 4}), std::vector<float>(12));
+        gb.Op(Node::kSize, {c}, output);
+    }
+    ScheduleComputation(graph, 0);
+
+    runtime::XCProgramProto program;
+    xcvm::Emit(graph, &program);
+
+    int num_constants = 0;
+    for (const runtime::XCInstructionProto& inst : program.instructions()) {
+        EXPECT_NE(runtime::XCInstructionProto::Size, inst.op());
+        if (inst.op() == runtime::XCInstructionProto::IntConstant) {
+            ++num_constants;
+            ASSERT_EQ(1, inst.inputs(0).longs_size());
+            EXPECT_EQ(3 * 4, inst.inputs(0).longs(0));
+        }
+    }
+    EXPECT_EQ(1, num_constants);
+}
+
+TEST(XCVMTest, ShapesFollowRuntimeBatchSize) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    // The model declares a batch size of 2 but is run with 4.
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", Type(Dtype::kFloat32, {2, 3}));
+    Value* size = graph.AddOutputValue("size", Type(Dtype::kInt64, {}));
+    Value* reshaped = graph.AddOutputValue("reshaped", Type(Dtype::kFloat32, {2, 3}));
+    {
+        GraphBuilder gb(&graph, "test", size);
+        gb.Op(Node::kSize, {input}, size);
+        Value* shape = gb.Op(Node::kShape, {input});
+        shape->set_type(new Type(Dtype::kInt64, {2}));
+        gb.Op(Node::kReshape, {input, shape}, reshaped);
+    }
+    ScheduleComputation(graph, 0);
+
+    runtime::XCProgramProto program;
+    xcvm::Emit(graph, &program);
+    for (const runtime::XCInstructionProto& inst : program.instructions()) {
+        EXPECT_NE(runtime::XCInstructionProto::IntConstant, inst.op());
+        EXPECT_NE(runtime::XCInstructionProto::StaticReshape, inst.op());
+    }
+
+    runtime::XCVM xcvm(program);
+    runtime::InOuts inputs;
+    chainerx::Array in = chainerx::Ones({4, 3}, chainerx::Dtype::kFloat32);
+    inputs.emplace("input", std::shared_ptr<runtime::XCVMVar>(new runtime::XCVMVar(in)));
+    runtime::InOuts outputs = xcvm.Run(inputs, runtime::XCVMOptions());
+    ASSERT_EQ(1, outputs.count("size"));
+    ASSERT_EQ(1, outputs.count("reshaped"));
+    EXPECT_EQ(12, static_cast<int64_t>(chainerx::AsScalar(outputs["size"]->GetArray())));
+    EXPECT_EQ(chainerx::Shape({4, 3}), outputs["reshaped"]->GetArray().shape());
+}
+
+TEST(XCVMTest, StaticReshapeAndIdentityAlias) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    Graph graph("test");
+    Value* input = graph.AddInputValue("input", Type(Dtype::kFloat32, {2, 3}));
+    Value* output = graph.AddOutputValue("output", Type(Dtype::kFloat32, {3, 2}));
+    GraphBuilder gb(&graph, "test", output);
+    Value* shape = gb.Const(Type(Dtype::kInt64, {2}), std::vector<int64_t>{3, 2});
+    Value* reshaped = gb.Op(Node::kReshape, {input, shape});
+    Value* id1 = gb.Op(Node::kIdentity, {reshaped});
+    Value* id2 = gb.Op(Node::kIdentity, {id1});
+    gb.Op(Node::kNeg, {id2}, output);
+    ScheduleComputation(graph, 0);
+
+    runtime::XCProgramProto program;
+    xcvm::Emit(graph, &program);
+    // std::cerr << program.DebugString() << std::endl;
+
+    int num_static_reshapes = 0;
+    for (const runtime::XCInstructionProto& inst : program.instructions()) {
+        EXPECT_NE(runtime::XCInstructionProto::Reshape, inst.op());
+        EXPECT_NE(runtime::XCInstructionProto::Identity, inst.op());
+        EXPECT_NE(runtime::XCInstructionProto::IntConstant, inst.op());
+        if (inst.op() == runtime::XCInstructionProto::StaticReshape) {
+            ++num_static_reshapes;
+            ASSERT_EQ(2, inst.inputs(1).ints_size());
+            EXPECT_EQ(3, inst.inputs(1).ints(0));
+            EXPECT_EQ(2, inst.inputs(1).ints(1));
+        }
+    }
+    EXPECT_EQ(1, num_static_reshapes);
+
+    runtime::XCVM xcvm(program);
+    runtime::InOuts inputs;
+    chainerx::Array in = chainerx::testing::BuildArray({2, 3}).WithData<float>({0, 1, 2, 3, 4, 5});
+    inputs.emplace("input", std::shared_ptr<runtime::XCVMVar>(new runtime::XCVMVar(in)));
+    runtime::InOuts outputs = xcvm.Run(inputs, runtime::XCVMOptions());
+    ASSERT_EQ(1, outputs.count("output"));
+    chainerx::Array e = chainerx::testing::BuildArray({3, 2}).WithData<float>({0, -1, -2, -3, -4, -5});
+    EXPECT_TRUE(chainerx::AllClose(e, outputs["output"]->GetArray(), 0, 0));
+}
+
+TEST(XCVMTest, EmitCpp) {
+    std::string test_path = std::string(kONNXTestDataDir) + "/node/test_add/";
+    std::string model_path = test_path + "model.onnx";
+    onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(model_path));
+    Model model(xmodel);
+    RunDefaultPasses(&model);
+
+    runtime::XCProgramProto program;
+    xcvm::Emit(model, &program);
+
+    std::ostringstream header, source;
+    xcvm::EmitCpp(program, "test_add", "test_add.h", header, source);
+    EXPECT_NE(std::string::npos, header.str().find("InOuts test_add("));
+    const std::string& code = source.str();
+    EXPECT_NE(std::string::npos, code.find("#include \"test_add.h\""));
+    EXPECT_NE(std::string::npos, code.find("GetInput(inputs, \"x\")"));
+    EXPECT_NE(std::string::npos, code.find("GetInput(inputs, \"y\")"));
+    EXPECT_NE(std::string::npos, code.find("XCVMState st(options, 3, inputs);"));
+    EXPECT_NE(std::string::npos, code.find("if (IsNull(v0) || IsNull(v1)) {"));
+    EXPECT_NE(std::string::npos, code.find("static_cast<AddOp*>(ops[2].get())->RunImpl(&st, "));
+    EXPECT_NE(std::string::npos, code.find("outputs.emplace(\"sum\", "));
+    EXPECT_NE(std::string::npos, code.find(runtime::kAOTEntryPointName));
+}
+
 }  // namespace
 }  // namespace chainer_compiler
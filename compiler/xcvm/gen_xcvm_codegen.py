@@ -31,11 +31,23 @@ def gen_xcvm_codegen_h():
         signature = make_codegen_signature(op.name, op.inputs, op.outputs)
         lines.append(signature + ';')
 
+    lines.append('// Types of operands of an XCVM op, named as in xcvm_defs.py,')
+    lines.append('// e.g., "ARRAY" or "INTS".')
+    lines.append('struct XCVMOpSignature {')
+    lines.append('bool typed;')
+    lines.append('std::vector<std::string> inputs;')
+    lines.append('std::vector<std::string> outputs;')
+    lines.append('};')
+    lines.append('const XCVMOpSignature& GetXCVMOpSignature(runtime::XCInstructionProto::Op op);')
+
     with open(args.output_dir + '/gen_xcvm_codegen.h', 'w') as f:
         f.write(r'''// Auto-generated by gen_xcvm.py
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <compiler/xcvm/xcvm_value.h>
 #include <runtime/xcvm.pb.h>
 
@@ -81,9 +93,25 @@ def gen_xcvm_codegen_cc():
 
         lines.append('}')
 
+    lines.append('const XCVMOpSignature& GetXCVMOpSignature(XCInstructionProto::Op op) {')
+    lines.append('static const std::map<XCInstructionProto::Op, XCVMOpSignature> signatures = {')
+    for op in XC_ALL_OPS:
+        inputs = ', '.join('"%s"' % typ for typ, _ in op.inputs)
+        outputs = ', '.join('"%s"' % typ for typ, _ in op.outputs)
+        lines.append('{XCInstructionProto::%s, {%s, {%s}, {%s}}},' %
+                     (op.name, 'true' if op.typed else 'false', inputs, outputs))
+    lines.append('};')
+    lines.append('auto found = signatures.find(op);')
+    lines.append('CHECK(found != signatures.end()) << "Unknown op: " << op;')
+    lines.append('return found->second;')
+    lines.append('}')
+
     with open(args.output_dir + '/gen_xcvm_codegen.cc', 'w') as f:
         f.write(r'''// Auto-generated by gen_xcvm.py
 
+#include <map>
+
+#include <common/log.h>
 #include <compiler/gen_xcvm_codegen.h>
 #include <runtime/xcvm.pb.h>
 
@@ -1,8 +1,49 @@
 #include "data_iterator.h"
 
+#include <map>
+
 #include <common/log.h>
 
-DataIterator::DataIterator(int buf_size) : buf_size_(buf_size) {
+class DataIterator::BufferPool {
+public:
+    explicit BufferPool(size_t max_free_buffers) : max_free_buffers_(max_free_buffers) {
+    }
+
+    ~BufferPool() {
+        for (auto& p : free_buffers_) {
+            for (char* buf : p.second) delete[] buf;
+        }
+    }
+
+    char* Get(size_t size) {
+        std::unique_lock<std::mutex> lock{mu_};
+        std::vector<char*>& bufs = free_buffers_[size];
+        if (bufs.empty()) return new char[size];
+        char* buf = bufs.back();
+        bufs.pop_back();
+        return buf;
+    }
+
+    void Put(size_t size, char* buf) {
+        std::unique_lock<std::mutex> lock{mu_};
+        std::vector<char*>& bufs = free_buffers_[size];
+        if (bufs.size() < max_free_buffers_) {
+            bufs.push_back(buf);
+        } else {
+            delete[] buf;
+        }
+    }
+
+private:
+    std::mutex mu_;
+    std::map<size_t, std::vector<char*>> free_buffers_;
+    const size_t max_free_buffers_;
+};
+
+DataIterator::DataIterator(int buf_size) : buf_(buf_size), buf_size_(static_cast<size_t>(buf_size)) {
+    CHECK_LT(0, buf_size);
+    // Batches in the ring, one being consumed, and one being produced.
+    pool_ = std::make_shared<BufferPool>(buf_size + 2);
 }
 
 DataIterator::~DataIterator() {
@@ -12,16 +53,25 @@ DataIterator::~DataIterator() {
 std::vector<chainerx::Array> DataIterator::GetNext() {
     std::unique_lock<std::mutex> lock{mu_};
     CHECK(thread_.get());
-    while (buf_.empty()) {
+    while (buf_count_ == 0) {
         if (is_iteration_finished_) return {};
         cond_.wait(lock);
     }
-    auto ret = buf_.front();
-    buf_.pop();
+    std::vector<chainerx::Array> ret = std::move(buf_[buf_head_]);
+    buf_[buf_head_].clear();
+    buf_head_ = (buf_head_ + 1) % buf_size_;
+    buf_count_--;
     cond_.notify_all();
     return ret;
 }
 
+std::shared_ptr<void> DataIterator::AllocateBuffer(size_t size) {
+    // The deleter keeps the pool alive as arrays may outlive the
+    // iterator.
+    std::shared_ptr<BufferPool> pool = pool_;
+    return std::shared_ptr<void>(pool->Get(size), [pool, size](void* buf) { pool->Put(size, static_cast<char*>(buf)); });
+}
+
 void DataIterator::Start() {
     std::unique_lock<std::mutex> lock{mu_};
     thread_.reset(new std::thread([this]() { Loop(); }));
@@ -55,14 +105,15 @@ void DataIterator::Loop() {
             cond_.notify_all();
             return;
         }
-        while (buf_.size() == buf_size_) {
+        while (buf_count_ == buf_size_) {
             cond_.wait(lock);
             if (should_finish_) {
                 cond_.notify_all();
                 return;
             }
         }
-        buf_.push(next);
+        buf_[(buf_head_ + buf_count_) % buf_size_] = std::move(next);
+        buf_count_++;
         cond_.notify_all();
     }
 }
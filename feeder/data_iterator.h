@@ -1,8 +1,9 @@
 #pragma once
 
 #include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -16,20 +17,36 @@ public:
 
     virtual std::vector<chainerx::Array> GetNextImpl() = 0;
 
+    virtual std::string GetStatus() const {
+        return "";
+    }
+
     void Start();
     void Terminate();
 
 protected:
+    // `buf_size` is the number of batches prefetched ahead.
     explicit DataIterator(int buf_size);
 
+    // Returns a buffer of `size` bytes. The buffer goes back to a pool
+    // once all arrays referring to it are gone so steady-state feeding
+    // does not allocate.
+    std::shared_ptr<void> AllocateBuffer(size_t size);
+
 private:
+    class BufferPool;
+
     void Loop();
 
     std::unique_ptr<std::thread> thread_;
     std::mutex mu_;
     std::condition_variable cond_;
-    std::queue<std::vector<chainerx::Array>> buf_;
-    const int buf_size_;
+    // A ring of `buf_size_` batches. Batches are moved in and out.
+    std::vector<std::vector<chainerx::Array>> buf_;
+    size_t buf_head_ = 0;
+    size_t buf_count_ = 0;
+    const size_t buf_size_;
+    std::shared_ptr<BufferPool> pool_;
     bool should_finish_ = false;
     bool is_iteration_finished_ = false;
 };
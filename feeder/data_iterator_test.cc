@@ -1,5 +1,7 @@
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <set>
 
 #include <gtest/gtest.h>
 
@@ -31,6 +33,34 @@ private:
     int end_;
 };
 
+class RecyclingDataIterator : public DataIterator {
+public:
+    RecyclingDataIterator() : DataIterator(3) {
+    }
+
+    std::vector<chainerx::Array> GetNextImpl() override {
+        if (counter_ == 100) return {};
+        std::shared_ptr<void> data = AllocateBuffer(sizeof(counter_) * 1024);
+        {
+            std::unique_lock<std::mutex> lock{mu_};
+            buffers_.insert(data.get());
+        }
+        std::memcpy(data.get(), &counter_, sizeof(counter_));
+        counter_++;
+        return {chainerx::FromContiguousHostData({}, chainerx::Dtype::kInt32, data)};
+    }
+
+    size_t num_buffers() {
+        std::unique_lock<std::mutex> lock{mu_};
+        return buffers_.size();
+    }
+
+private:
+    int counter_ = 0;
+    std::mutex mu_;
+    std::set<void*> buffers_;
+};
+
 TEST(TestDataIterator, Basic) {
     chainerx::Context ctx;
     chainerx::SetGlobalDefaultContext(&ctx);
@@ -56,4 +86,18 @@ TEST(TestDataIterator, Finish) {
     iter.Terminate();
 }
 
+TEST(TestDataIterator, RecycleBuffers) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+    RecyclingDataIterator iter;
+    iter.Start();
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(i, int64_t(chainerx::AsScalar(iter.GetNext()[0])));
+    }
+    EXPECT_TRUE(iter.GetNext().empty());
+    // Batches in the ring, one being consumed, and one being produced.
+    EXPECT_GE(5, iter.num_buffers());
+    iter.Terminate();
+}
+
 }  // namespace
@@ -0,0 +1,89 @@
+// Measures the throughput of the feeder alone.
+//
+// Usage: feeder_bench <train.txt> <mean.bin> [num_workers] [batch_size] [iterations]
+//        feeder_bench --handoff [iterations]
+//
+// Comma-separated shards ending with ".rec" are read by RecordIterator.
+// --handoff feeds empty batches to measure the cost of passing batches
+// between the producer thread and the consumer alone.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <chainerx/context.h>
+#include <chainerx/routines/creation.h>
+
+#include <common/log.h>
+#include <common/strutil.h>
+#include <feeder/imagenet_iterator.h>
+#include <feeder/record_dataset.h>
+
+namespace {
+
+class NullIterator : public DataIterator {
+public:
+    NullIterator() : DataIterator(3) {
+    }
+
+    std::vector<chainerx::Array> GetNextImpl() override {
+        return {chainerx::FromContiguousHostData({1}, chainerx::Dtype::kFloat32, AllocateBuffer(sizeof(float)))};
+    }
+};
+
+void RunHandoffBench(int iterations) {
+    NullIterator iter;
+    iter.Start();
+    CHECK(!iter.GetNext().empty());
+    auto start = std::chrono::system_clock::now();
+    for (int i = 0; i < iterations; ++i) CHECK(!iter.GetNext().empty());
+    double elapsed = std::chrono::duration<double>(std::chrono::system_clock::now() - start).count();
+    iter.Terminate();
+    std::cout << "handoffs=" << iterations << " elapsed=" << elapsed << "s usec/handoff=" << elapsed * 1e6 / iterations << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && std::string(argv[1]) == "--handoff") {
+        chainerx::Context ctx;
+        chainerx::SetGlobalDefaultContext(&ctx);
+        RunHandoffBench(argc > 2 ? std::atoi(argv[2]) : 100000);
+        return 0;
+    }
+    if (argc < 3) QFAIL() << "Usage: " << argv[0] << " <train.txt> <mean.bin> [num_workers] [batch_size] [iterations]";
+    const int num_workers = argc > 3 ? std::atoi(argv[3]) : 1;
+    const int batch_size = argc > 4 ? std::atoi(argv[4]) : 32;
+    const int iterations = argc > 5 ? std::atoi(argv[5]) : 100;
+    const int height = 224;
+    const int width = 224;
+
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    std::vector<float> mean(LoadMean(argv[2], height, width));
+    std::unique_ptr<DataIterator> iter;
+    if (chainer_compiler::HasSuffix(argv[1], ".rec")) {
+        iter.reset(new RecordIterator(chainer_compiler::SplitString(argv[1], ","), 3, batch_size, mean, height, width));
+    } else {
+        iter.reset(new ImageNetIterator(argv[1], 3, batch_size, mean, height, width, num_workers));
+    }
+    iter->Start();
+
+    // Exclude the warm up of the pipeline.
+    CHECK(!iter->GetNext().empty());
+    auto start = std::chrono::system_clock::now();
+    int64_t num_images = 0;
+    for (int i = 0; i < iterations; ++i) {
+        std::vector<chainerx::Array> batch = iter->GetNext();
+        if (batch.empty()) break;
+        num_images += batch[0].shape()[0];
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::system_clock::now() - start).count();
+    iter->Terminate();
+
+    std::cout << "workers=" << num_workers << " batch_size=" << batch_size << " images=" << num_images << " elapsed=" << elapsed
+              << "s images/sec=" << num_images / elapsed << std::endl;
+}
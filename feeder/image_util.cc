@@ -0,0 +1,43 @@
+#include "image_util.h"
+
+#include <common/log.h>
+
+std::vector<float> MeanToCHW(const std::vector<float>& mean, int height, int width) {
+    CHECK_EQ(3 * height * width, mean.size());
+    std::vector<float> mean_chw(mean.size());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int k = 0; k < 3; ++k) {
+                mean_chw[(k * height + y) * width + x] = mean[(y * width + x) * 3 + k] / 255.0f;
+            }
+        }
+    }
+    return mean_chw;
+}
+
+void CropToCHW(
+        const uint8_t* image,
+        int64_t row_stride,
+        int by,
+        int bx,
+        bool bgr,
+        const std::vector<float>& mean_chw,
+        int height,
+        int width,
+        float* out) {
+    const int plane = height * width;
+    const float scale = 1.0f / 255.0f;
+    // The innermost loops have no dependencies so compilers vectorize
+    // them.
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = image + (by + y) * row_stride + bx * 3;
+        for (int k = 0; k < 3; ++k) {
+            const uint8_t* src = row + (bgr ? 2 - k : k);
+            const float* mean = &mean_chw[k * plane + y * width];
+            float* dst = out + k * plane + y * width;
+            for (int x = 0; x < width; ++x) {
+                dst[x] = src[x * 3] * scale - mean[x];
+            }
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// Converts a mean image in HWC to CHW, pre-multiplied by 1/255.
+std::vector<float> MeanToCHW(const std::vector<float>& mean, int height, int width);
+
+// Crops a `height` x `width` region at (`by`, `bx`) of a uint8 HWC
+// image whose rows are `row_stride` bytes apart, and writes it to
+// `out` as float CHW scaled by 1/255 minus `mean_chw`. Channels are
+// reversed when `bgr` is true so `out` is always RGB.
+void CropToCHW(
+        const uint8_t* image,
+        int64_t row_stride,
+        int by,
+        int bx,
+        bool bgr,
+        const std::vector<float>& mean_chw,
+        int height,
+        int width,
+        float* out);
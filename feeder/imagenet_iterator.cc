@@ -1,9 +1,9 @@
 #include "imagenet_iterator.h"
 
 #include <algorithm>
-#include <cstring>
 #include <fstream>
 #include <random>
+#include <thread>
 
 #include <opencv2/highgui/highgui.hpp>
 
@@ -11,23 +11,23 @@
 
 #include <common/log.h>
 #include <common/strutil.h>
-
-namespace {
-
-chainerx::Array MakeArray(chainerx::Dtype dtype, chainerx::Shape shape, const void* src) {
-    int64_t size = chainerx::GetItemSize(dtype) * shape.GetTotalSize();
-    std::shared_ptr<void> data(new char[size], std::default_delete<char[]>());
-    std::memcpy(data.get(), src, size);
-    chainerx::Array array(chainerx::FromContiguousHostData(shape, dtype, data));
-    return array;
-}
-
-}  // namespace
+#include <feeder/image_util.h>
 
 ImageNetIterator::ImageNetIterator(
-        const std::string& labeled_image_dataset, int buf_size, int batch_size, const std::vector<float>& mean, int height, int width)
-    : DataIterator(buf_size), batch_size_(batch_size), mean_(mean), height_(height), width_(width) {
-    CHECK_EQ(3 * height * width, mean_.size());
+        const std::string& labeled_image_dataset,
+        int buf_size,
+        int batch_size,
+        const std::vector<float>& mean,
+        int height,
+        int width,
+        int num_workers)
+    : DataIterator(buf_size),
+      batch_size_(batch_size),
+      mean_(MeanToCHW(mean, height, width)),
+      height_(height),
+      width_(width),
+      num_workers_(num_workers) {
+    CHECK_LT(0, num_workers);
     std::ifstream ifs(labeled_image_dataset);
     while (ifs) {
         std::string filename;
@@ -38,6 +38,37 @@ ImageNetIterator::ImageNetIterator(
     std::mt19937 mt;
     std::shuffle(dataset_.begin(), dataset_.end(), mt);
     // std::cerr << dataset_.size() << " examples" << std::endl;
+
+    for (int i = 1; i < num_workers; ++i) workers_.emplace_back([this]() { WorkerLoop(); });
+}
+
+ImageNetIterator::~ImageNetIterator() {
+    // Stop the loader thread before the workers it may be waiting for.
+    Terminate();
+    {
+        std::unique_lock<std::mutex> lock{tasks_mu_};
+        should_stop_workers_ = true;
+    }
+    tasks_cond_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+}
+
+bool ImageNetIterator::RunTask(std::unique_lock<std::mutex>* lock) {
+    if (tasks_.empty()) return false;
+    std::function<void()> task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock->unlock();
+    task();
+    lock->lock();
+    if (--num_pending_tasks_ == 0) done_cond_.notify_all();
+    return true;
+}
+
+void ImageNetIterator::WorkerLoop() {
+    std::unique_lock<std::mutex> lock{tasks_mu_};
+    while (!should_stop_workers_) {
+        if (!RunTask(&lock)) tasks_cond_.wait(lock);
+    }
 }
 
 std::vector<chainerx::Array> ImageNetIterator::GetNextImpl() {
@@ -51,35 +82,46 @@ std::vector<chainerx::Array> ImageNetIterator::GetNextImpl() {
     }
     if (batch.empty()) return {};
 
-    std::vector<float> image_data(batch.size() * 3 * height_ * width_);
-    std::vector<int> label_data(batch.size());
-    for (size_t i = 0; i < batch.size(); ++i) {
-        label_data[i] = batch[i].second;
-        cv::Mat image = cv::imread(batch[i].first);
-        int bi = i * 3 * height_ * width_;
-        CHECK_GE(image.rows, height_);
-        CHECK_GE(image.cols, width_);
-        int by = (image.rows - height_) / 2;
-        int bx = (image.cols - width_) / 2;
-        for (int y = 0; y < height_; ++y) {
-            for (int x = 0; x < width_; ++x) {
-                int ii = (y * width_ + x) * 3;
-                for (int k = 0; k < 3; ++k) {
-                    image_data[bi + ii + k] = image.at<cv::Vec3b>(by + y, bx + x)(2 - k);
-                    image_data[bi + ii + k] -= mean_[ii + k];
-                    image_data[bi + ii + k] *= 1.0 / 255.0;
-                }
-            }
+    // Workers write straight into the buffers which back the returned
+    // arrays.
+    const int bs = static_cast<int>(batch.size());
+    const int64_t image_size = 3 * height_ * width_;
+    std::shared_ptr<void> image_data = AllocateBuffer(sizeof(float) * bs * image_size);
+    std::shared_ptr<void> label_data = AllocateBuffer(sizeof(int) * bs);
+    float* images = static_cast<float*>(image_data.get());
+    int* labels = static_cast<int*>(label_data.get());
+    {
+        std::unique_lock<std::mutex> lock{tasks_mu_};
+        for (int i = 0; i < bs; ++i) {
+            tasks_.emplace_back([this, &batch, images, labels, image_size, i]() {
+                labels[i] = batch[i].second;
+                DecodeImage(batch[i].first, images + i * image_size);
+            });
+        }
+        num_pending_tasks_ += bs;
+        tasks_cond_.notify_all();
+        while (RunTask(&lock)) {
         }
+        while (num_pending_tasks_) done_cond_.wait(lock);
     }
 
     std::vector<chainerx::Array> arrays;
-    int bs = static_cast<int>(batch.size());
-    arrays.push_back(MakeArray(chainerx::Dtype::kFloat32, {bs, 3, height_, width_}, image_data.data()));
-    arrays.push_back(MakeArray(chainerx::Dtype::kInt32, {bs}, label_data.data()));
+    arrays.push_back(chainerx::FromContiguousHostData({bs, 3, height_, width_}, chainerx::Dtype::kFloat32, image_data));
+    arrays.push_back(chainerx::FromContiguousHostData({bs}, chainerx::Dtype::kInt32, label_data));
     return arrays;
 }
 
+void ImageNetIterator::DecodeImage(const std::string& filename, float* out) const {
+    cv::Mat image = cv::imread(filename);
+    CHECK(image.data) << "Failed to read: " << filename;
+    CHECK_GE(image.rows, height_);
+    CHECK_GE(image.cols, width_);
+    const int by = (image.rows - height_) / 2;
+    const int bx = (image.cols - width_) / 2;
+    // Crop, convert BGR HWC to RGB CHW, and normalize.
+    CropToCHW(image.ptr<uint8_t>(0), image.step, by, bx, true /* bgr */, mean_, height_, width_, out);
+}
+
 std::string ImageNetIterator::GetStatus() const {
     return chainer_compiler::StrCat(iter_, "/", dataset_.size());
 }
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -10,20 +15,50 @@
 
 class ImageNetIterator : public DataIterator {
 public:
+    // Images of a batch are decoded by `num_workers` threads, which
+    // live as long as the iterator. Each image is written to its own
+    // slot of the batch so the order of examples does not depend on
+    // scheduling.
     explicit ImageNetIterator(
-            const std::string& labeled_image_dataset, int buf_size, int batch_size, const std::vector<float>& mean, int height, int width);
+            const std::string& labeled_image_dataset,
+            int buf_size,
+            int batch_size,
+            const std::vector<float>& mean,
+            int height,
+            int width,
+            int num_workers = 1);
+    ~ImageNetIterator() override;
 
     std::vector<chainerx::Array> GetNextImpl() override;
 
-    std::string GetStatus() const;
+    std::string GetStatus() const override;
 
 private:
+    void DecodeImage(const std::string& filename, float* out) const;
+
+    // Runs a task in `tasks_` if any. `lock` must hold `tasks_mu_`.
+    bool RunTask(std::unique_lock<std::mutex>* lock);
+
+    void WorkerLoop();
+
     std::vector<std::pair<std::string, int>> dataset_;
     size_t iter_ = 0;
     int batch_size_;
+    // The mean image in CHW, pre-multiplied by 1/255.
     std::vector<float> mean_;
     int height_;
     int width_;
+    int num_workers_;
+
+    // The loader thread decodes images too, so there are
+    // `num_workers_ - 1` of them.
+    std::vector<std::thread> workers_;
+    std::mutex tasks_mu_;
+    std::condition_variable tasks_cond_;
+    std::condition_variable done_cond_;
+    std::deque<std::function<void()>> tasks_;
+    int num_pending_tasks_ = 0;
+    bool should_stop_workers_ = false;
 };
 
 std::vector<float> LoadMean(const std::string& filename, int height, int width);
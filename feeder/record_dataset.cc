@@ -0,0 +1,162 @@
+#include "record_dataset.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include <chainerx/routines/creation.h>
+
+#include <common/log.h>
+#include <common/strutil.h>
+#include <feeder/image_util.h>
+
+namespace {
+
+uint64_t AlignUp(uint64_t v, uint64_t alignment) {
+    return (v + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+RecordShardWriter::RecordShardWriter(const std::string& filename, int height, int width)
+    : ofs_(filename, std::ios::binary), header_() {
+    CHECK(ofs_) << "Failed to open: " << filename;
+    std::memcpy(header_.magic, kRecordShardMagic, sizeof(header_.magic));
+    header_.version = kRecordShardVersion;
+    header_.height = height;
+    header_.width = width;
+    header_.channels = 3;
+    header_.record_stride = AlignUp(3 * height * width, 64);
+    header_.data_offset = kRecordShardAlignment;
+    ofs_.seekp(header_.data_offset);
+}
+
+RecordShardWriter::~RecordShardWriter() {
+    if (!finished_) Finish();
+}
+
+void RecordShardWriter::Add(const uint8_t* rgb_hwc, int label) {
+    CHECK(!finished_);
+    const size_t size = 3 * header_.height * header_.width;
+    ofs_.write(reinterpret_cast<const char*>(rgb_hwc), size);
+    const std::vector<char> padding(header_.record_stride - size);
+    ofs_.write(padding.data(), padding.size());
+    labels_.push_back(label);
+}
+
+void RecordShardWriter::Finish() {
+    CHECK(!finished_);
+    finished_ = true;
+    header_.num_records = labels_.size();
+    header_.labels_offset = header_.data_offset + header_.num_records * header_.record_stride;
+    ofs_.write(reinterpret_cast<const char*>(labels_.data()), labels_.size() * sizeof(int32_t));
+    ofs_.seekp(0);
+    ofs_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+    ofs_.close();
+    CHECK(ofs_) << "Failed to write a record shard";
+}
+
+RecordIterator::RecordIterator(
+        const std::vector<std::string>& shards,
+        int buf_size,
+        int batch_size,
+        const std::vector<float>& mean,
+        int height,
+        int width,
+        int num_epochs)
+    : DataIterator(buf_size),
+      num_epochs_(num_epochs),
+      batch_size_(batch_size),
+      mean_(MeanToCHW(mean, height, width)),
+      height_(height),
+      width_(width) {
+    CHECK_LT(0, num_epochs);
+    for (const std::string& filename : shards) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        CHECK_LE(0, fd) << "Failed to open: " << filename;
+        struct stat st;
+        CHECK_EQ(0, fstat(fd, &st)) << filename;
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        CHECK_NE(MAP_FAILED, addr) << "Failed to mmap: " << filename;
+        close(fd);
+
+        Shard shard{static_cast<const char*>(addr), static_cast<size_t>(st.st_size), static_cast<const RecordShardHeader*>(addr)};
+        const RecordShardHeader& header = *shard.header;
+        CHECK_LE(sizeof(RecordShardHeader), shard.size) << filename;
+        CHECK_EQ(0, std::memcmp(header.magic, kRecordShardMagic, sizeof(header.magic))) << "Not a record shard: " << filename;
+        CHECK_EQ(kRecordShardVersion, header.version) << filename;
+        CHECK_EQ(3, header.channels) << filename;
+        CHECK_GE(header.height, static_cast<uint32_t>(height)) << filename;
+        CHECK_GE(header.width, static_cast<uint32_t>(width)) << filename;
+        CHECK_LE(3 * static_cast<uint64_t>(header.height) * header.width, header.record_stride) << filename;
+        CHECK_LE(sizeof(RecordShardHeader), header.data_offset) << filename;
+        // The records must end before the labels, which must end before
+        // the end of the file. Divide rather than multiply so broken
+        // headers cannot overflow.
+        CHECK_LE(header.data_offset, header.labels_offset) << filename;
+        CHECK_LE(header.num_records, (header.labels_offset - header.data_offset) / header.record_stride) << filename;
+        CHECK_LE(header.labels_offset, shard.size) << filename;
+        CHECK_LE(header.num_records, (shard.size - header.labels_offset) / sizeof(int32_t)) << filename;
+        // Records are read in a random order.
+        madvise(addr, shard.size, MADV_RANDOM);
+
+        for (uint64_t i = 0; i < header.num_records; ++i) dataset_.emplace_back(shards_.size(), i);
+        shards_.push_back(shard);
+    }
+    std::shuffle(dataset_.begin(), dataset_.end(), mt_);
+}
+
+RecordIterator::~RecordIterator() {
+    // Stop the loader thread before unmapping shards it may read.
+    Terminate();
+    for (const Shard& shard : shards_) {
+        munmap(const_cast<char*>(shard.base), shard.size);
+    }
+}
+
+std::vector<chainerx::Array> RecordIterator::GetNextImpl() {
+    if (iter_ == dataset_.size()) {
+        if (epoch_ + 1 >= num_epochs_) return {};
+        ++epoch_;
+        iter_ = 0;
+        // `mt_` has advanced, so each epoch sees a different order.
+        std::shuffle(dataset_.begin(), dataset_.end(), mt_);
+    }
+    const int bs = static_cast<int>(std::min<size_t>(batch_size_, dataset_.size() - iter_));
+    if (bs == 0) return {};
+
+    const int64_t image_size = 3 * height_ * width_;
+    std::shared_ptr<void> image_data = AllocateBuffer(sizeof(float) * bs * image_size);
+    std::shared_ptr<void> label_data = AllocateBuffer(sizeof(int) * bs);
+    float* images = static_cast<float*>(image_data.get());
+    int* labels = static_cast<int*>(label_data.get());
+    for (int i = 0; i < bs; ++i) {
+        const std::pair<int, uint64_t>& example = dataset_[iter_++];
+        const Shard& shard = shards_[example.first];
+        const int32_t* shard_labels = reinterpret_cast<const int32_t*>(shard.base + shard.header->labels_offset);
+        labels[i] = shard_labels[example.second];
+        CopyRecord(shard, example.second, images + i * image_size);
+    }
+
+    std::vector<chainerx::Array> arrays;
+    arrays.push_back(chainerx::FromContiguousHostData({bs, 3, height_, width_}, chainerx::Dtype::kFloat32, image_data));
+    arrays.push_back(chainerx::FromContiguousHostData({bs}, chainerx::Dtype::kInt32, label_data));
+    return arrays;
+}
+
+void RecordIterator::CopyRecord(const Shard& shard, uint64_t index, float* out) const {
+    const RecordShardHeader& header = *shard.header;
+    const uint8_t* record = reinterpret_cast<const uint8_t*>(shard.base + header.data_offset + index * header.record_stride);
+    const int by = (header.height - height_) / 2;
+    const int bx = (header.width - width_) / 2;
+    CropToCHW(record, header.width * 3, by, bx, false /* bgr */, mean_, height_, width_, out);
+}
+
+std::string RecordIterator::GetStatus() const {
+    return chainer_compiler::StrCat("epoch ", epoch_ + 1, "/", num_epochs_, " ", iter_, "/", dataset_.size());
+}
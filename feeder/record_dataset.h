@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <chainerx/array.h>
+
+#include <feeder/data_iterator.h>
+
+// A shard of pre-decoded examples. The layout of a shard is
+//
+// [RecordShardHeader] [padding] [records...] [labels...]
+//
+// Records start at `data_offset`, which is aligned to
+// kRecordShardAlignment. Each record is an RGB uint8 HWC image that
+// occupies `record_stride` bytes, so the i-th record is at
+// data_offset + i * record_stride. Labels are int32s stored at
+// `labels_offset`.
+struct RecordShardHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t height;
+    uint32_t width;
+    uint32_t channels;
+    uint64_t num_records;
+    uint64_t record_stride;
+    uint64_t data_offset;
+    uint64_t labels_offset;
+};
+
+constexpr char kRecordShardMagic[8] = {'C', 'C', 'R', 'E', 'C', 'O', 'R', 'D'};
+constexpr uint32_t kRecordShardVersion = 1;
+constexpr uint64_t kRecordShardAlignment = 4096;
+
+class RecordShardWriter {
+public:
+    RecordShardWriter(const std::string& filename, int height, int width);
+    ~RecordShardWriter();
+
+    void Add(const uint8_t* rgb_hwc, int label);
+
+    void Finish();
+
+private:
+    std::ofstream ofs_;
+    RecordShardHeader header_;
+    std::vector<int32_t> labels_;
+    bool finished_ = false;
+};
+
+// Iterates over examples in memory-mapped shards `num_epochs` times.
+// The order of examples is reshuffled at the start of each epoch.
+// Batches have the same format as ImageNetIterator's.
+class RecordIterator : public DataIterator {
+public:
+    explicit RecordIterator(
+            const std::vector<std::string>& shards,
+            int buf_size,
+            int batch_size,
+            const std::vector<float>& mean,
+            int height,
+            int width,
+            int num_epochs = 1);
+    ~RecordIterator() override;
+
+    std::vector<chainerx::Array> GetNextImpl() override;
+
+    std::string GetStatus() const override;
+
+private:
+    struct Shard {
+        const char* base;
+        size_t size;
+        const RecordShardHeader* header;
+    };
+
+    void CopyRecord(const Shard& shard, uint64_t index, float* out) const;
+
+    std::vector<Shard> shards_;
+    // Pairs of a shard index and a record index in the shard.
+    std::vector<std::pair<int, uint64_t>> dataset_;
+    size_t iter_ = 0;
+    std::mt19937 mt_;
+    int epoch_ = 0;
+    const int num_epochs_;
+    int batch_size_;
+    // The mean image in CHW, pre-multiplied by 1/255.
+    std::vector<float> mean_;
+    int height_;
+    int width_;
+};
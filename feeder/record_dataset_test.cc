@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <chainerx/context.h>
+#include <chainerx/routines/manipulation.h>
+
+#include <feeder/record_dataset.h>
+
+namespace {
+
+TEST(TestRecordDataset, Basic) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const std::string filename = "record_dataset_test.rec";
+    const int kHeight = 4;
+    const int kWidth = 6;
+    {
+        RecordShardWriter writer(filename, kHeight, kWidth);
+        for (int i = 0; i < 5; ++i) {
+            std::vector<uint8_t> image(kHeight * kWidth * 3);
+            for (size_t j = 0; j < image.size(); ++j) image[j] = static_cast<uint8_t>(i * 10 + j % 3);
+            writer.Add(image.data(), i + 100);
+        }
+    }
+
+    // Crop the center 2x2 of each 4x6 image.
+    std::vector<float> mean(2 * 2 * 3, 0.0f);
+    std::set<int> labels;
+    {
+        RecordIterator iter({filename}, 3, 2, mean, 2, 2);
+        iter.Start();
+        for (int i = 0; i < 3; ++i) {
+            std::vector<chainerx::Array> a(iter.GetNext());
+            ASSERT_EQ(2, a.size());
+            const int bs = a[1].shape()[0];
+            EXPECT_EQ(chainerx::Shape({bs, 3, 2, 2}), a[0].shape());
+            for (int b = 0; b < bs; ++b) {
+                int label = static_cast<int>(chainerx::AsScalar(a[1].At({b})));
+                labels.insert(label);
+                for (int k = 0; k < 3; ++k) {
+                    float expected = ((label - 100) * 10 + k) / 255.0f;
+                    EXPECT_FLOAT_EQ(expected, static_cast<float>(chainerx::AsScalar(a[0].At({b, k, 1, 1}))));
+                }
+            }
+        }
+        EXPECT_TRUE(iter.GetNext().empty());
+    }
+    EXPECT_EQ(std::set<int>({100, 101, 102, 103, 104}), labels);
+    std::remove(filename.c_str());
+}
+
+TEST(TestRecordDataset, Epochs) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const std::string filename = "record_dataset_test_epochs.rec";
+    const int kNumRecords = 16;
+    {
+        RecordShardWriter writer(filename, 1, 1);
+        for (int i = 0; i < kNumRecords; ++i) {
+            std::vector<uint8_t> image(3);
+            writer.Add(image.data(), i);
+        }
+    }
+
+    std::vector<float> mean(3, 0.0f);
+    std::vector<std::vector<int>> orders(2);
+    {
+        RecordIterator iter({filename}, 3, 4, mean, 1, 1, 2 /* num_epochs */);
+        iter.Start();
+        for (std::vector<int>& order : orders) {
+            while (order.size() < kNumRecords) {
+                std::vector<chainerx::Array> a(iter.GetNext());
+                ASSERT_EQ(2, a.size());
+                for (int b = 0; b < a[1].shape()[0]; ++b) order.push_back(static_cast<int>(chainerx::AsScalar(a[1].At({b}))));
+            }
+            ASSERT_EQ(kNumRecords, order.size());
+            EXPECT_EQ(kNumRecords, std::set<int>(order.begin(), order.end()).size());
+        }
+        EXPECT_TRUE(iter.GetNext().empty());
+    }
+    // Each epoch is shuffled anew.
+    EXPECT_NE(orders[0], orders[1]);
+    std::remove(filename.c_str());
+}
+
+}  // namespace
@@ -1,4 +1,7 @@
+#include <chrono>
+#include <future>
 #include <memory>
+#include <set>
 
 #include <compiler/onnx.h>
 
@@ -7,6 +10,7 @@
 
 #include <chainerx/array.h>
 #include <chainerx/array_body.h>
+#include <chainerx/context.h>
 
 #include <common/log.h>
 #include <common/protoutil.h>
@@ -20,6 +24,7 @@
 #include <runtime/xcvm.pb.h>
 #include <runtime/xcvm_var.h>
 #include <tools/util.h>
+#include <tools/weight_store.h>
 
 namespace py = pybind11;
 
@@ -28,15 +33,19 @@ namespace {
 
 typedef std::shared_ptr<chainerx::internal::ArrayBody> ArrayBodyPtr;
 typedef std::shared_ptr<runtime::XCVMVar> VarPtr;
+typedef std::shared_future<std::vector<VarPtr>> RunFuture;
 
 std::shared_ptr<Graph> LoadGraph(const std::string& onnx_path) {
     onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(onnx_path));
+    ResolveExternalDataLocations(onnx_path, &xmodel);
     return std::make_shared<Graph>(xmodel.graph());
 }
 
-std::map<std::string, VarPtr> LoadParams(const std::shared_ptr<Graph>& graph) {
+std::map<std::string, VarPtr> LoadParams(const std::shared_ptr<Graph>& graph, const std::string& weight_store_dir) {
+    std::unique_ptr<runtime::WeightStore> weight_store;
+    if (!weight_store_dir.empty()) weight_store.reset(new runtime::WeightStore(weight_store_dir));
     std::map<std::string, VarPtr> params;
-    for (auto& p : runtime::LoadParams(*graph)) {
+    for (auto& p : runtime::LoadParams(*graph, weight_store.get())) {
         chainerx::Array array = p.second->GetArray();
         CHECK(params.emplace(p.first, std::make_shared<runtime::XCVMVar>(array)).second);
     }
@@ -89,7 +98,7 @@ std::string Dump(const std::shared_ptr<Graph>& graph) {
 
 void InitGraph(py::module& m) {
     py::class_<Graph, std::shared_ptr<Graph>> c{m, "Graph"};
-    c.def("params", &LoadParams, "Load parameters of a model");
+    c.def("params", &LoadParams, "Load parameters of a model", py::arg("weight_store") = "");
     c.def("compile", &Compile, "Compile a model");
     c.def("input_names", &GetInputNames, "Names of inputs");
     c.def("output_names", &GetOutputNames, "Names of outputs");
@@ -98,6 +107,17 @@ void InitGraph(py::module& m) {
     c.def("dump", &Dump, "Dump a model to a string");
 }
 
+runtime::XCVMOptions MakeXCVMOptions(bool trace, bool verbose, bool training, bool check_nans, bool check_infs, bool dump_memory_usage) {
+    runtime::XCVMOptions xcvm_opts;
+    if (trace) xcvm_opts.trace_level = 1;
+    if (verbose) xcvm_opts.trace_level = 2;
+    xcvm_opts.is_training = training;
+    xcvm_opts.check_nans = check_nans;
+    xcvm_opts.check_infs = check_infs;
+    xcvm_opts.dump_memory_usage = dump_memory_usage;
+    return xcvm_opts;
+}
+
 std::map<std::string, VarPtr> Run(
         const std::shared_ptr<runtime::XCVM>& xcvm,
         const std::map<std::string, VarPtr>& inputs,
@@ -106,18 +126,86 @@ std::map<std::string, VarPtr> Run(
         bool training,
         bool check_nans,
         bool check_infs,
-        bool dump_memory_usage) {
-    runtime::XCVMOptions xcvm_opts;
-    if (trace) xcvm_opts.trace_level = 1;
-    if (verbose) xcvm_opts.trace_level = 2;
-    xcvm_opts.is_training = training;
-    xcvm_opts.check_nans = check_nans;
-    xcvm_opts.check_infs = check_infs;
-    xcvm_opts.dump_memory_usage = dump_memory_usage;
-    runtime::InOuts outputs(xcvm->Run(inputs, xcvm_opts));
+        bool dump_memory_usage,
+        const std::vector<std::string>& output_names) {
+    runtime::XCVMOptions xcvm_opts(MakeXCVMOptions(trace, verbose, training, check_nans, check_infs, dump_memory_usage));
+    py::gil_scoped_release release;
+    runtime::InOuts outputs(xcvm->Run(inputs, xcvm_opts, {output_names.begin(), output_names.end()}));
     return outputs;
 }
 
+// An XCVM with fixed parameters, options, and names of inputs and
+// outputs. Inputs and outputs are passed as lists so only the
+// arrays which change per call are converted.
+class BoundXCVM : public std::enable_shared_from_this<BoundXCVM> {
+public:
+    BoundXCVM(
+            const std::shared_ptr<runtime::XCVM>& xcvm,
+            const std::map<std::string, VarPtr>& params,
+            const std::vector<std::string>& input_names,
+            const std::vector<std::string>& output_names,
+            const runtime::XCVMOptions& xcvm_opts)
+        : xcvm_(xcvm),
+          params_(params.begin(), params.end()),
+          input_names_(input_names),
+          output_names_(output_names),
+          output_name_set_(output_names.begin(), output_names.end()),
+          xcvm_opts_(xcvm_opts) {
+    }
+
+    // Must be called without the GIL.
+    std::vector<VarPtr> Run(const std::vector<VarPtr>& inputs) const {
+        CHECK_EQ(input_names_.size(), inputs.size());
+        runtime::InOuts xcvm_inputs(params_);
+        for (size_t i = 0; i < inputs.size(); ++i) xcvm_inputs[input_names_[i]] = inputs[i];
+        // Only instructions needed for the bound outputs are run.
+        runtime::InOuts outputs(xcvm_->Run(xcvm_inputs, xcvm_opts_, output_name_set_));
+        std::vector<VarPtr> results;
+        for (const std::string& name : output_names_) {
+            auto found = outputs.find(name);
+            CHECK(found != outputs.end()) << "No output: " << name;
+            results.push_back(found->second);
+        }
+        return results;
+    }
+
+    RunFuture RunAsync(const std::vector<VarPtr>& inputs) {
+        // ChainerX keeps the default context and device per thread.
+        chainerx::Context* context = &chainerx::GetDefaultContext();
+        chainerx::Device* device = &chainerx::GetDefaultDevice();
+        std::shared_ptr<BoundXCVM> self = shared_from_this();
+        return std::async(std::launch::async, [self, inputs, context, device]() {
+                   chainerx::SetDefaultContext(context);
+                   chainerx::SetDefaultDevice(device);
+                   return self->Run(inputs);
+               })
+                .share();
+    }
+
+private:
+    std::shared_ptr<runtime::XCVM> xcvm_;
+    runtime::InOuts params_;
+    std::vector<std::string> input_names_;
+    std::vector<std::string> output_names_;
+    std::set<std::string> output_name_set_;
+    runtime::XCVMOptions xcvm_opts_;
+};
+
+std::shared_ptr<BoundXCVM> Bind(
+        const std::shared_ptr<runtime::XCVM>& xcvm,
+        const std::map<std::string, VarPtr>& params,
+        const std::vector<std::string>& input_names,
+        const std::vector<std::string>& output_names,
+        bool trace,
+        bool verbose,
+        bool training,
+        bool check_nans,
+        bool check_infs,
+        bool dump_memory_usage) {
+    return std::make_shared<BoundXCVM>(
+            xcvm, params, input_names, output_names, MakeXCVMOptions(trace, verbose, training, check_nans, check_infs, dump_memory_usage));
+}
+
 void InitXCVM(py::module& m) {
     py::class_<runtime::XCVM, std::shared_ptr<runtime::XCVM>> c{m, "XCVM"};
     c.def("run",
@@ -129,7 +217,30 @@ void InitXCVM(py::module& m) {
           py::arg("training") = false,
           py::arg("check_nans") = false,
           py::arg("check_infs") = false,
+          py::arg("dump_memory_usage") = false,
+          py::arg("output_names") = std::vector<std::string>());
+    c.def("bind",
+          &Bind,
+          "Fix parameters, options, and the order of inputs and outputs",
+          py::arg("params"),
+          py::arg("input_names"),
+          py::arg("output_names"),
+          py::arg("trace") = false,
+          py::arg("verbose") = false,
+          py::arg("training") = false,
+          py::arg("check_nans") = false,
+          py::arg("check_infs") = false,
           py::arg("dump_memory_usage") = false);
+
+    py::class_<BoundXCVM, std::shared_ptr<BoundXCVM>> b{m, "BoundXCVM"};
+    b.def("run", &BoundXCVM::Run, "Run the model with a list of inputs", py::call_guard<py::gil_scoped_release>());
+    b.def("run_async", &BoundXCVM::RunAsync, "Run the model in another thread and return a future", py::arg("inputs"));
+
+    py::class_<RunFuture> f{m, "RunFuture"};
+    f.def("result", [](const RunFuture& f) { return f.get(); }, "Wait for and return the outputs", py::call_guard<py::gil_scoped_release>());
+    f.def("done",
+          [](const RunFuture& f) { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; },
+          "Check if the outputs are ready");
 }
 
 bool IsArray(const VarPtr& v) {
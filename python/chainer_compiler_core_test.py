@@ -43,6 +43,51 @@ def test_inference():
     assert 'op_type: "ChainerLinear"' in graph.dump()
 
 
+def test_partial_run():
+    graph = chainer_compiler_core.load('out/ch2o_node_Linear/model.onnx')
+    params = graph.params()
+    input_names = graph.input_names()
+    output_names = graph.output_names()
+    xcvm = graph.compile()
+
+    # Parameters of the first head are not needed for the second one.
+    inputs = {k: v for k, v in params.items() if not k.startswith('/l1/')}
+    t1 = aranges(5, 7)
+    inputs[input_names[0]] = chainer_compiler_core.value(t1)
+
+    y2 = chainerx.dot(t1, params['/l2/W'].array().T)
+
+    outputs = xcvm.run(inputs, output_names=[output_names[1]])
+    assert list(outputs.keys()) == [output_names[1]]
+    chainerx.testing.assert_allclose(y2, outputs[output_names[1]].array())
+
+
+def test_bound_run():
+    graph = chainer_compiler_core.load('out/ch2o_node_Linear/model.onnx')
+    params = graph.params()
+    input_names = graph.input_names()
+    output_names = graph.output_names()
+    xcvm = graph.compile()
+    bound = xcvm.bind(params, input_names, output_names)
+
+    t1 = aranges(5, 7)
+    y1 = chainerx.dot(t1, params['/l1/W'].array().T) + params['/l1/b'].array()
+    y2 = chainerx.dot(t1, params['/l2/W'].array().T)
+
+    outputs = bound.run([chainer_compiler_core.value(t1)])
+    assert len(outputs) == 2
+    chainerx.testing.assert_allclose(y1, outputs[0].array())
+    chainerx.testing.assert_allclose(y2, outputs[1].array())
+
+    futures = [bound.run_async([chainer_compiler_core.value(t1)])
+               for _ in range(3)]
+    for future in futures:
+        outputs = future.result()
+        assert future.done()
+        chainerx.testing.assert_allclose(y1, outputs[0].array())
+        chainerx.testing.assert_allclose(y2, outputs[1].array())
+
+
 def test_backprop():
     graph = chainer_compiler_core.load('out/ch2o_node_Linear_backprop/model.onnx')
     params = graph.params()
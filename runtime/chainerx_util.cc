@@ -1,8 +1,10 @@
 #include "runtime/chainerx_util.h"
 
+#include <algorithm>
 #include <cstring>
 #include <limits>
 #include <numeric>
+#include <thread>
 
 #include <chainerx/array.h>
 #include <chainerx/context.h>
@@ -124,23 +126,59 @@ chainerx::Array Sigmoid(chainerx::Array a) {
 
 namespace {
 
-uint32_t xorshift() {
-    static uint32_t y = 2463534242;
-    y = y ^ (y << 13);
-    y = y ^ (y >> 17);
-    return y = y ^ (y << 15);
+// Philox4x32-10 from "Parallel Random Numbers: As Easy as 1, 2, 3"
+// by Salmon et al.
+void Philox4x32(uint64_t counter, uint64_t seed, uint32_t out[4]) {
+    uint32_t c[4] = {static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0, 0};
+    uint32_t k[2] = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+    for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = static_cast<uint64_t>(0xD2511F53) * c[0];
+        uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57) * c[2];
+        uint32_t n[4] = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+                         static_cast<uint32_t>(p1),
+                         static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+                         static_cast<uint32_t>(p0)};
+        std::memcpy(c, n, sizeof(c));
+        k[0] += 0x9E3779B9;
+        k[1] += 0xBB67AE85;
+    }
+    std::memcpy(out, c, sizeof(c));
 }
 
 }  // namespace
 
-chainerx::Array SlowRandom(chainerx::Shape shape) {
-    int64_t size = shape.GetTotalSize();
-    double denominator = 1.0 / std::pow(2.0, 32);
-    std::vector<float> values(size);
-    for (int64_t i = 0; i < size; ++i) {
-        values[i] = xorshift() * denominator;
+chainerx::Array PhiloxRandom(chainerx::Shape shape, uint64_t seed, uint64_t offset) {
+    if (IsCudaDevice(&chainerx::GetDefaultDevice())) {
+        WARN_ONCE("Random numbers are generated on host and copied to GPU, which is slow.");
+    }
+    const int64_t num_counters = (shape.GetTotalSize() + 3) / 4;
+    std::shared_ptr<float> values(new float[num_counters * 4], std::default_delete<float[]>());
+    // Iterations are independent, so split the counters across threads
+    // when there are enough of them to pay for the threads.
+    auto fill = [&values, seed, offset](int64_t begin, int64_t end) {
+        // Use the top 24 bits so every value is exactly representable.
+        const float denominator = 1.0f / (1 << 24);
+        for (int64_t i = begin; i < end; ++i) {
+            uint32_t r[4];
+            Philox4x32(offset + i, seed, r);
+            for (int j = 0; j < 4; ++j) values.get()[i * 4 + j] = (r[j] >> 8) * denominator;
+        }
+    };
+    const int64_t kMinCountersPerThread = 1 << 14;
+    const int64_t num_threads =
+            std::max<int64_t>(1, std::min<int64_t>(std::thread::hardware_concurrency(), num_counters / kMinCountersPerThread));
+    std::vector<std::thread> threads;
+    for (int64_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(fill, num_counters * t / num_threads, num_counters * (t + 1) / num_threads);
     }
-    return MakeArray(chainerx::Dtype::kFloat32, shape, values.data());
+    fill(0, num_counters / num_threads);
+    for (std::thread& thread : threads) thread.join();
+    // The buffer is adopted without a copy on the native device.
+    return chainerx::FromContiguousHostData(shape, chainerx::Dtype::kFloat32, values);
+}
+
+void* RawStartPtr(const chainerx::Array& a) {
+    return static_cast<uint8_t*>(a.raw_data()) + a.offset();
 }
 
 chainerx::Array CastTo(const chainerx::Array& input, chainerx::Dtype dtype) {
@@ -28,7 +28,15 @@ chainerx::Array PadSequence(const std::vector<chainerx::Array>& inputs, int64_t
 
 chainerx::Array Sigmoid(chainerx::Array a);
 
-chainerx::Array SlowRandom(chainerx::Shape shape);
+// Returns uniform random numbers in [0, 1) from the counter-based
+// Philox4x32-10 generator. The result only depends on `seed` and
+// `offset` so a stream can be split and regenerated freely. The
+// returned array consumes (size + 3) / 4 counters from `offset`.
+chainerx::Array PhiloxRandom(chainerx::Shape shape, uint64_t seed, uint64_t offset);
+
+// Returns the address of the first element of `a`. Unlike
+// `raw_data()`, this takes the offset of a view into account.
+void* RawStartPtr(const chainerx::Array& a);
 
 chainerx::Array CastTo(const chainerx::Array& input, chainerx::Dtype dtype);
 
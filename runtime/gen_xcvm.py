@@ -56,6 +56,8 @@ def gen_gen_xcvm_ops_h():
                     args.append('const XCVMSequence& %s' % name)
                 elif typ == OPAQUE:
                     args.append('const XCVMOpaque& %s' % name)
+                elif typ == SCALAR:
+                    args.append('int64_t %s' % name)
                 else:
                     assert typ in FIELD_TYPES, 'Unknown type: %s' % typ
 
@@ -67,6 +69,8 @@ def gen_gen_xcvm_ops_h():
                     args.append('XCVMSequence* %s' % name)
                 elif typ == OPAQUE:
                     output_ctypes.append('XCVMOpaque*')
+                elif typ == SCALAR:
+                    output_ctypes.append('int64_t')
                 else:
                     output_ctypes.append('chainerx::Array')
 
@@ -80,6 +84,7 @@ def gen_gen_xcvm_ops_h():
             rettype = 'void'
         lines.append('%s RunImpl(%s);' % (rettype, ', '.join(args)))
         lines.append('virtual void Run(XCVMState* st);')
+        lines.append('virtual void RunInstrumented(XCVMState* st);')
 
         lines.append('private:')
         for inp in op.inputs:
@@ -123,46 +128,10 @@ namespace runtime {
 ''')
 
 
-def gen_gen_xcvm_ops_cc():
+def gen_run_body(op, instrumented):
     lines = []
 
-    for op in XC_ALL_OPS:
-        # Emit constructor.
-        lines.append('%sOp::%sOp(const XCInstructionProto& inst)'
-                     ': XCVMOp(inst) {' %
-                     (op.name, op.name))
-        for i, inp in enumerate(op.inputs):
-            enum = inp.typ.replace('OPTIONAL_', '')
-            lines.append('CHECK_EQ(XCValueProto::%s, ' % (enum) +
-                         'inst.inputs(%d).type()) ' % (i) +
-                         '<< "Unexpected type for input#%d of %s";' % (i, op.name))
-            pfn = inp.proto_field_name()
-            name = inp.name
-            if not inp.is_repeated():
-                lines.append('%s = inst.inputs(%d).%s();' % (name, i, pfn))
-            elif inp.typ == INTS:
-                lines.append('%s = %s(' % (name, STACK_VECTOR) +
-                             'inst.inputs(%d).ints().begin(), ' % (i) +
-                             'inst.inputs(%d).ints().end());' % (i))
-            else:
-                lines.append('%s.assign(inst.inputs(%d).%s().begin(),' % (name, i, pfn) +
-                             'inst.inputs(%d).%s().end());' % (i, pfn))
-
-        for i, (typ, name) in enumerate(op.outputs):
-            if typ == ARRAY_LIST:
-                lines.append('%s.assign(inst.outputs().begin(), '
-                             'inst.outputs().end());' % name)
-            else:
-                lines.append('%s = inst.outputs(%d);' % (name, i))
-
-        if op.has_custom_field:
-            lines.append('InitImpl();')
-
-        lines.append('}')
-
-        # Emit Run.
-        lines.append('void %sOp::Run(XCVMState* st) {' % op.name)
-
+    if instrumented:
         lines.append('if (st->trace_level() && !debug_info().empty()) '
                      'std::cerr << "# " << debug_info() << std::endl;')
 
@@ -178,7 +147,7 @@ def gen_gen_xcvm_ops_cc():
         for i, (typ, name) in enumerate(op.inputs):
             if i:
                 line += ' << ", "'
-            if typ in [ARRAY, OPTIONAL_ARRAY, SEQUENCE, OPAQUE]:
+            if typ in [ARRAY, OPTIONAL_ARRAY, SEQUENCE, OPAQUE, SCALAR]:
                 line += ' << "%s" << %s' % (sigil(typ), name)
             elif typ in (INT, FLOAT):
                 line += ' << %s' % name
@@ -194,102 +163,166 @@ def gen_gen_xcvm_ops_cc():
         line += ' << std::endl;'
         lines.append(line)
 
-        line = 'if (st->trace_level()) std::cerr'
-        for typ, name in op.inputs:
-            if typ in [ARRAY, OPTIONAL_ARRAY, SEQUENCE]:
-                line += ' << " %s" << %s << "="' % (sigil(typ), name)
-                line += ' << st->GetVarString(%s)' % name
-            elif typ == ARRAY_LIST:
-                line += ' << st->GetVarListString(%s)' % name
-        if op.outputs:
-            line += ' << " ->"'
-        if not line.endswith('std::cerr'):
-            line += ';'
+    line = 'if (st->trace_level()) std::cerr'
+    for typ, name in op.inputs:
+        if typ in [ARRAY, OPTIONAL_ARRAY, SEQUENCE]:
+            line += ' << " %s" << %s << "="' % (sigil(typ), name)
+            line += ' << st->GetVarString(%s)' % name
+        elif typ == ARRAY_LIST:
+            line += ' << st->GetVarListString(%s)' % name
+        elif typ == SCALAR:
+            line += ' << " %s" << %s << "="' % (sigil(typ), name)
+            line += ' << st->GetScalar(%s)' % name
+    if op.outputs:
+        line += ' << " ->"'
+    if not line.endswith('std::cerr'):
+        line += ';'
+        if instrumented:
             lines.append(line)
 
-        if op.typed:
-            args = ['st']
-
-            # TODO(hamaji): Remove this code by removing null gradients.
-            conds = []
-            for typ, name in op.inputs:
-                if typ in ARG_TYPES and typ != ARRAY_LIST:
-                    conds.append('(%s >= 0 && st->GetVar(%s)->IsNull())' %
-                                 (name, name))
-            if conds:
-                lines.append('if (%s) {' % (' || '.join(conds)))
-                lines.append('WARN_ONCE("%s skipped\\n");' % op.name)
-                for typ, oname in op.outputs:
-                    if typ in ARG_TYPES and typ != ARRAY_LIST:
-                        lines.append('st->SetVar(%s, XCVMVar());' % oname)
-                lines.append('return;')
-                lines.append('}')
+    if op.typed:
+        args = ['st']
 
-            for typ, name in op.inputs:
-                if typ == ARRAY:
-                    args.append('st->GetArray(%s)' % name)
-                elif typ == OPTIONAL_ARRAY:
-                    args.append('st->GetOptionalArray(%s)' % name)
-                elif typ == ARRAY_LIST:
-                    args.append('st->GetArrayList(%s)' % name)
-                elif typ == SEQUENCE:
-                    args.append('*st->GetSequence(%s)' % name)
-                elif typ == OPAQUE:
-                    args.append('st->GetOpaque(%s)' % name)
+        # TODO(hamaji): Remove this code by removing null gradients.
+        conds = []
+        for typ, name in op.inputs:
+            if typ in ARG_TYPES and typ not in (ARRAY_LIST, SCALAR):
+                conds.append('(%s >= 0 && st->GetVar(%s)->IsNull())' %
+                             (name, name))
+        if conds:
+            lines.append('if (%s) {' % (' || '.join(conds)))
+            lines.append('WARN_ONCE("%s skipped\\n");' % op.name)
+            for typ, oname in op.outputs:
+                if typ in ARG_TYPES and typ not in (ARRAY_LIST, SCALAR):
+                    lines.append('st->SetVar(%s, XCVMVar());' % oname)
+            lines.append('return;')
+            lines.append('}')
 
-            outputs = []
-            for output in op.outputs:
-                typ, name = output
-                if typ == SEQUENCE:
-                    args.append('st->CreateSequence(%s)' % name)
-                else:
-                    outputs.append(output)
+        for typ, name in op.inputs:
+            if typ == ARRAY:
+                args.append('st->GetArray(%s)' % name)
+            elif typ == OPTIONAL_ARRAY:
+                args.append('st->GetOptionalArray(%s)' % name)
+            elif typ == ARRAY_LIST:
+                args.append('st->GetArrayList(%s)' % name)
+            elif typ == SEQUENCE:
+                args.append('*st->GetSequence(%s)' % name)
+            elif typ == OPAQUE:
+                args.append('st->GetOpaque(%s)' % name)
+            elif typ == SCALAR:
+                args.append('st->GetScalar(%s)' % name)
+
+        outputs = []
+        for output in op.outputs:
+            typ, name = output
+            if typ == SEQUENCE:
+                args.append('st->CreateSequence(%s)' % name)
+            else:
+                outputs.append(output)
 
-            call = 'RunImpl(%s)' % ', '.join(args)
-            if len(outputs) == 1:
-                typ, name = outputs[0]
-                if typ == ARRAY_LIST:
-                    lines.append('st->SetArrayList(%s, %s);' % (name, call))
-                elif typ == OPAQUE:
-                    lines.append('st->SetOpaque(%s, %s);' % (name, call))
+        call = 'RunImpl(%s)' % ', '.join(args)
+        if len(outputs) == 1:
+            typ, name = outputs[0]
+            if typ == ARRAY_LIST:
+                lines.append('st->SetArrayList(%s, %s);' % (name, call))
+            elif typ == OPAQUE:
+                lines.append('st->SetOpaque(%s, %s);' % (name, call))
+            elif typ == SCALAR:
+                lines.append('st->SetScalar(%s, %s);' % (name, call))
+            else:
+                lines.append('st->SetArray(%s, %s);' % (name, call))
+        elif outputs:
+            lines.append('auto r_ = ' + call + ';')
+            for i, (typ, output) in enumerate(outputs):
+                # TODO(hamaji): Revisit optional outputs.
+                if typ == OPAQUE:
+                    lines.append('if (%s >= 0) st->SetOpaque(%s, std::get<%d>(r_));' % (output, output, i))
+                    lines.append('else delete std::get<%d>(r_);' % i)
+                elif typ == SCALAR:
+                    lines.append('if (%s >= 0) st->SetScalar(%s, std::get<%d>(r_));' % (output, output, i))
                 else:
-                    lines.append('st->SetArray(%s, %s);' % (name, call))
-            elif outputs:
-                lines.append('auto r_ = ' + call + ';')
-                for i, (typ, output) in enumerate(outputs):
-                    # TODO(hamaji): Revisit optional outputs.
-                    if typ == OPAQUE:
-                        lines.append('if (%s >= 0) st->SetOpaque(%s, std::get<%d>(r_));' % (output, output, i))
-                        lines.append('else delete std::get<%d>(r_);' % i)
-                    else:
-                        lines.append('if (%s >= 0) st->SetArray(%s, std::get<%d>(r_));' % (output, output, i))
+                    lines.append('if (%s >= 0) st->SetArray(%s, std::get<%d>(r_));' % (output, output, i))
+                if instrumented:
                     lines.append(line)
-            else:
-                lines.append(call + ';')
         else:
-            lines.append('RunImpl(st);')
+            lines.append(call + ';')
+    else:
+        lines.append('RunImpl(st);')
+
+    if not instrumented:
+        return lines
+
+    line = 'if (st->trace_level()) std::cerr'
+    for typ, name in op.outputs:
+        if typ in [ARRAY, OPTIONAL_ARRAY, SEQUENCE, OPAQUE]:
+            line += ' << " %s" << %s << "="' % (sigil(typ), name)
+            line += ' << st->GetVarString(%s)' % name
+        elif typ == ARRAY_LIST:
+            line += ' << st->GetVarListString(%s)' % name
+        elif typ == SCALAR:
+            line += ' << " %s" << %s << "="' % (sigil(typ), name)
+            line += ' << st->GetScalar(%s)' % name
+        else:
+            raise RuntimeError('Unknown output type: %s' % typ)
+    line += ' << std::endl;'
+    lines.append(line)
 
-        line = 'if (st->trace_level()) std::cerr'
-        for typ, name in op.outputs:
-            if typ in [ARRAY, OPTIONAL_ARRAY, SEQUENCE, OPAQUE]:
-                line += ' << " %s" << %s << "="' % (sigil(typ), name)
-                line += ' << st->GetVarString(%s)' % name
-            elif typ == ARRAY_LIST:
-                line += ' << st->GetVarListString(%s)' % name
+    if any(typ != SCALAR for typ, _ in op.outputs):
+        inputs_str = ', '.join([name for typ, name in op.inputs
+                                if typ == ARRAY or typ == OPTIONAL_ARRAY])
+        outputs_str = ', '.join([name for typ, name in op.outputs
+                                 if typ != SCALAR])
+        lines.append('if (st->check_infs()) st->CheckInfs({%s}, {%s});' %
+                     (inputs_str, outputs_str))
+        lines.append('if (st->check_nans()) st->CheckNans({%s}, {%s});' %
+                     (inputs_str, outputs_str))
+
+    return lines
+
+
+def gen_gen_xcvm_ops_cc():
+    lines = []
+
+    for op in XC_ALL_OPS:
+        # Emit constructor.
+        lines.append('%sOp::%sOp(const XCInstructionProto& inst)'
+                     ': XCVMOp(inst) {' %
+                     (op.name, op.name))
+        for i, inp in enumerate(op.inputs):
+            enum = inp.typ.replace('OPTIONAL_', '')
+            lines.append('CHECK_EQ(XCValueProto::%s, ' % (enum) +
+                         'inst.inputs(%d).type()) ' % (i) +
+                         '<< "Unexpected type for input#%d of %s";' % (i, op.name))
+            pfn = inp.proto_field_name()
+            name = inp.name
+            if not inp.is_repeated():
+                lines.append('%s = inst.inputs(%d).%s();' % (name, i, pfn))
+            elif inp.typ == INTS:
+                lines.append('%s = %s(' % (name, STACK_VECTOR) +
+                             'inst.inputs(%d).ints().begin(), ' % (i) +
+                             'inst.inputs(%d).ints().end());' % (i))
             else:
-                raise RuntimeError('Unknown output type: %s' % typ)
-        line += ' << std::endl;'
-        lines.append(line)
+                lines.append('%s.assign(inst.inputs(%d).%s().begin(),' % (name, i, pfn) +
+                             'inst.inputs(%d).%s().end());' % (i, pfn))
 
-        if op.outputs:
-            inputs_str = ', '.join([name for typ, name in op.inputs
-                                    if typ == ARRAY or typ == OPTIONAL_ARRAY])
-            outputs_str = ', '.join(op.output_names)
-            lines.append('if (st->check_infs()) st->CheckInfs({%s}, {%s});' %
-                         (inputs_str, outputs_str))
-            lines.append('if (st->check_nans()) st->CheckNans({%s}, {%s});' %
-                         (inputs_str, outputs_str))
+        for i, (typ, name) in enumerate(op.outputs):
+            if typ == ARRAY_LIST:
+                lines.append('%s.assign(inst.outputs().begin(), '
+                             'inst.outputs().end());' % name)
+            else:
+                lines.append('%s = inst.outputs(%d);' % (name, i))
 
+        if op.has_custom_field:
+            lines.append('InitImpl();')
+
+        lines.append('}')
+
+        # Emit Run and RunInstrumented.
+        lines.append('void %sOp::Run(XCVMState* st) {' % op.name)
+        lines += gen_run_body(op, instrumented=False)
+        lines.append('}')
+        lines.append('void %sOp::RunInstrumented(XCVMState* st) {' % op.name)
+        lines += gen_run_body(op, instrumented=True)
         lines.append('}')
 
     lines.append('XCVMOp* MakeXCVMOp(const XCInstructionProto& inst) {')
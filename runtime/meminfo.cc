@@ -1,5 +1,9 @@
 #include "runtime/meminfo.h"
 
+#include <unistd.h>
+
+#include <fstream>
+
 #ifdef CHAINER_COMPILER_ENABLE_CUDA
 #include <cuda_runtime.h>
 #endif  // CHAINER_COMPILER_ENABLE_CUDA
@@ -22,5 +26,12 @@ int64_t GetMemoryUsageInBytes() {
 #endif  // CHAINER_COMPILER_ENABLE_CUDA
 }
 
+int64_t GetResidentBytes() {
+    std::ifstream ifs("/proc/self/statm");
+    int64_t total_pages, resident_pages;
+    if (!(ifs >> total_pages >> resident_pages)) return -1;
+    return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
 }  // namespace runtime
 }  // namespace chainer_compiler
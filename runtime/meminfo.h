@@ -10,5 +10,9 @@ extern bool g_meminfo_enabled;
 // Returns -1 when info is not implemented.
 int64_t GetMemoryUsageInBytes();
 
+// Returns the resident set size of this process in bytes, or -1 when
+// info is not available.
+int64_t GetResidentBytes();
+
 }  // namespace runtime
 }  // namespace chainer_compiler
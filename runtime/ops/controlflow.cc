@@ -1,3 +1,5 @@
+#include <chainerx/native/native_backend.h>
+#include <chainerx/routines/creation.h>
 #include <chainerx/routines/manipulation.h>
 
 #include <common/log.h>
@@ -22,5 +24,49 @@ void JmpFalseOp::RunImpl(XCVMState* st, const chainerx::Array& cond) {
     }
 }
 
+int64_t ScalarConstantOp::RunImpl(XCVMState* st) {
+    return value;
+}
+
+int64_t ScalarFromArrayOp::RunImpl(XCVMState* st, const chainerx::Array& input) {
+    return static_cast<int64_t>(chainerx::AsScalar(input));
+}
+
+chainerx::Array ScalarToArrayOp::RunImpl(XCVMState* st, int64_t input) {
+    return chainerx::Full({}, input, static_cast<chainerx::Dtype>(dtype), chainerx::GetNativeBackend().GetDevice(0));
+}
+
+int64_t ScalarAddOp::RunImpl(XCVMState* st, int64_t a, int64_t b) {
+    return a + b;
+}
+
+int64_t ScalarSubOp::RunImpl(XCVMState* st, int64_t a, int64_t b) {
+    return a - b;
+}
+
+int64_t ScalarMulOp::RunImpl(XCVMState* st, int64_t a, int64_t b) {
+    return a * b;
+}
+
+int64_t ScalarLessOp::RunImpl(XCVMState* st, int64_t a, int64_t b) {
+    return a < b;
+}
+
+int64_t ScalarEqualOp::RunImpl(XCVMState* st, int64_t a, int64_t b) {
+    return a == b;
+}
+
+void ScalarJmpTrueOp::RunImpl(XCVMState* st, int64_t cond) {
+    if (cond) {
+        st->set_pc(pc - 1);
+    }
+}
+
+void ScalarJmpFalseOp::RunImpl(XCVMState* st, int64_t cond) {
+    if (!cond) {
+        st->set_pc(pc - 1);
+    }
+}
+
 }  // namespace runtime
 }  // namespace chainer_compiler
@@ -37,6 +37,26 @@ int64_t GetOptionalInt(XCVMState* st, int index, int64_t default_value) {
     }
 }
 
+chainerx::Array GetItem(XCVMVar* var, int64_t i) {
+    if (i < 0) i += GetSize(var);
+    switch (var->kind()) {
+        case XCVMVar::Kind::kArray:
+            CHECK_LT(i, var->GetArray().shape()[0]);
+            return var->GetArray().At({i});
+
+        case XCVMVar::Kind::kSequence: {
+            const XCVMSequence& v = *var->GetSequence();
+            CHECK_LT(i, v.size());
+            return v[i].GetArray();
+        }
+
+        case XCVMVar::Kind::kOpaque:
+        case XCVMVar::Kind::kNull:
+            CHECK(false) << var->DebugString();
+    }
+    CHECK(false);
+}
+
 }  // namespace
 
 void InOp::RunImpl(XCVMState* st) {
@@ -72,27 +92,12 @@ void GenericLenOp::RunImpl(XCVMState* st) {
 }
 
 void GenericGetItemOp::RunImpl(XCVMState* st) {
-    XCVMVar* var = st->GetVar(v);
-    int64_t size = GetSize(var);
     int64_t i = static_cast<int64_t>(chainerx::AsScalar(st->GetArray(index)));
-    if (i < 0) i += size;
-    switch (var->kind()) {
-        case XCVMVar::Kind::kArray:
-            CHECK_LT(i, var->GetArray().shape()[0]);
-            st->SetArray(output, var->GetArray().At({i}));
-            break;
-
-        case XCVMVar::Kind::kSequence: {
-            const XCVMSequence& v = *var->GetSequence();
-            CHECK_LT(i, v.size());
-            st->SetArray(output, v[i].GetArray());
-            break;
-        }
+    st->SetArray(output, GetItem(st->GetVar(v), i));
+}
 
-        case XCVMVar::Kind::kOpaque:
-        case XCVMVar::Kind::kNull:
-            CHECK(false) << var->DebugString();
-    }
+void GenericGetItemScalarOp::RunImpl(XCVMState* st) {
+    st->SetArray(output, GetItem(st->GetVar(v), st->GetScalar(index)));
 }
 
 void GenericGetSliceOp::RunImpl(XCVMState* st) {
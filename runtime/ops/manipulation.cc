@@ -17,8 +17,9 @@ chainerx::Array SizeOp::RunImpl(XCVMState* st, const chainerx::Array& data) {
     return MakeHostArray(chainerx::Dtype::kInt64, {}, &size);
 }
 
-chainerx::Array ReshapeOp::RunImpl(XCVMState* st, const chainerx::Array& data, const chainerx::Array& shape) {
-    chainerx::Shape s{ArrayToShape(shape)};
+namespace {
+
+chainerx::Array ReshapeImpl(const chainerx::Array& data, chainerx::Shape s) {
     int from_total_size = data.GetTotalSize();
     int to_total_size = 1;
     int to_minus_one_index = -1;
@@ -40,6 +41,16 @@ chainerx::Array ReshapeOp::RunImpl(XCVMState* st, const chainerx::Array& data, c
     return chainerx::Reshape(data, s);
 }
 
+}  // namespace
+
+chainerx::Array ReshapeOp::RunImpl(XCVMState* st, const chainerx::Array& data, const chainerx::Array& shape) {
+    return ReshapeImpl(data, ArrayToShape(shape));
+}
+
+chainerx::Array StaticReshapeOp::RunImpl(XCVMState* st, const chainerx::Array& data) {
+    return ReshapeImpl(data, chainerx::Shape{shape.begin(), shape.end()});
+}
+
 chainerx::Array ExpandOp::RunImpl(XCVMState* st, const chainerx::Array& data, const chainerx::Array& shape) {
     return chainerx::BroadcastTo(data, ArrayToShape(shape));
 }
@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include <chainerx/routines/creation.h>
 
 #include <common/log.h>
@@ -7,15 +9,38 @@
 namespace chainer_compiler {
 namespace runtime {
 
+namespace {
+
+const uint64_t kDropoutSeed = 0x5eed;
+
+}  // namespace
+
+// Each Dropout op draws from its own Philox stream so masks only
+// depend on the seed and how many times the op has run.
+class DropoutOp::DropoutImpl {
+public:
+    std::atomic<uint64_t> offset{0};
+};
+
+void DropoutOp::InitImpl() {
+    impl_ = new DropoutImpl();
+}
+
+DropoutOp::~DropoutOp() {
+    delete impl_;
+}
+
 std::tuple<chainerx::Array, chainerx::Array> DropoutOp::RunImpl(XCVMState* st, const chainerx::Array& data) {
     if (st->is_training()) {
-        WARN_ONCE("Dropout for training is slow.");
-        chainerx::Array rnd = SlowRandom(data.shape());
+        int64_t size = data.GetTotalSize();
+        uint64_t offset = impl_->offset.fetch_add((size + 3) / 4);
+        chainerx::Array rnd = PhiloxRandom(data.shape(), kDropoutSeed + id(), offset);
         chainerx::Array mask = CastTo(rnd > MakeScalarArray(ratio), data.dtype());
         chainerx::Array out = data * mask;
         return std::tuple<chainerx::Array, chainerx::Array>{out, mask};
     } else {
-        chainerx::Array mask = chainerx::OnesLike(data);
+        chainerx::Array mask;
+        if (this->mask >= 0) mask = chainerx::OnesLike(data);
         return std::tuple<chainerx::Array, chainerx::Array>{data, mask};
     }
 }
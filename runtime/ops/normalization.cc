@@ -147,7 +147,7 @@ std::tuple<chainerx::Array, XCVMOpaque*, chainerx::Array, chainerx::Array, chain
         const Array& gamma_reshaped = result.gamma;
         const Array& beta_reshaped = result.beta;
         chainerx::Array out = fb->Forward(x, gamma_reshaped, beta_reshaped);
-        XCVMOpaque* ctx = new BatchNormBackwardContext(std::move(fb), s.shape(), bias.shape());
+        XCVMOpaque* ctx = this->ctx >= 0 ? new BatchNormBackwardContext(std::move(fb), s.shape(), bias.shape()) : nullptr;
         chainerx::Array saved_mean, saved_var;
         if (this->saved_mean >= 0) {
             WARN_ONCE("saved_mean is implemented by re-calculation");
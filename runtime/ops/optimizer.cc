@@ -0,0 +1,155 @@
+#include <cmath>
+
+#include <chainerx/native/native_device.h>
+#include <chainerx/routines/math.h>
+
+#include <common/log.h>
+#include <runtime/chainerx_util.h>
+#include <runtime/gen_xcvm_ops.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+namespace {
+
+float AsFloat(const chainerx::Array& a) {
+    return static_cast<float>(chainerx::AsScalar(a));
+}
+
+// Whether all arrays can be updated by a single loop over raw fp32
+// buffers on the host.
+bool CanUpdateOnHost(const std::vector<const std::vector<chainerx::Array>*>& lists) {
+    for (const std::vector<chainerx::Array>* arrays : lists) {
+        for (const chainerx::Array& a : *arrays) {
+            if (a.dtype() != chainerx::Dtype::kFloat32 || !a.IsContiguous() ||
+                !dynamic_cast<const chainerx::native::NativeDevice*>(&a.device())) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+float* RawFloats(const chainerx::Array& a) {
+    return static_cast<float*>(RawStartPtr(a));
+}
+
+}  // namespace
+
+void AccumulateGradsOp::RunImpl(XCVMState* st, const std::vector<chainerx::Array>& accums, const std::vector<chainerx::Array>& grads) {
+    CHECK_EQ(accums.size(), grads.size());
+    if (CanUpdateOnHost({&accums, &grads})) {
+        for (size_t i = 0; i < accums.size(); ++i) {
+            CHECK_EQ(accums[i].shape(), grads[i].shape());
+            float* a = RawFloats(accums[i]);
+            const float* g = RawFloats(grads[i]);
+            const int64_t size = accums[i].GetTotalSize();
+            for (int64_t j = 0; j < size; ++j) a[j] += g[j];
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < accums.size(); ++i) {
+        chainerx::Array a = accums[i];
+        a += grads[i];
+    }
+}
+
+void MomentumSGDUpdateOp::RunImpl(
+        XCVMState* st,
+        const chainerx::Array& lr,
+        const chainerx::Array& grad_scale,
+        const std::vector<chainerx::Array>& params,
+        const std::vector<chainerx::Array>& grads,
+        const std::vector<chainerx::Array>& velocities) {
+    CHECK_EQ(params.size(), grads.size());
+    CHECK(velocities.empty() || velocities.size() == params.size());
+    const float alpha = AsFloat(lr);
+    const float scale = AsFloat(grad_scale);
+
+    if (CanUpdateOnHost({&params, &grads, &velocities})) {
+        for (size_t i = 0; i < params.size(); ++i) {
+            CHECK_EQ(params[i].shape(), grads[i].shape());
+            float* p = RawFloats(params[i]);
+            const float* g = RawFloats(grads[i]);
+            float* v = velocities.empty() ? nullptr : RawFloats(velocities[i]);
+            const int64_t size = params[i].GetTotalSize();
+            for (int64_t j = 0; j < size; ++j) {
+                const float d = g[j] * scale + weight_decay * p[j];
+                if (v) {
+                    v[j] = momentum * v[j] - alpha * d;
+                    p[j] += v[j];
+                } else {
+                    p[j] -= alpha * d;
+                }
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < params.size(); ++i) {
+        chainerx::Array p = params[i];
+        chainerx::Array d = grads[i] * scale;
+        if (weight_decay) d += p * weight_decay;
+        if (velocities.empty()) {
+            p -= d * alpha;
+        } else {
+            chainerx::Array v = velocities[i];
+            v *= momentum;
+            v -= d * alpha;
+            p += v;
+        }
+    }
+}
+
+void AdamUpdateOp::RunImpl(
+        XCVMState* st,
+        const chainerx::Array& lr,
+        const chainerx::Array& grad_scale,
+        const chainerx::Array& step,
+        const std::vector<chainerx::Array>& params,
+        const std::vector<chainerx::Array>& grads,
+        const std::vector<chainerx::Array>& ms,
+        const std::vector<chainerx::Array>& vs) {
+    CHECK_EQ(params.size(), grads.size());
+    CHECK_EQ(params.size(), ms.size());
+    CHECK_EQ(params.size(), vs.size());
+    const float alpha = AsFloat(lr);
+    const float scale = AsFloat(grad_scale);
+    chainerx::Array t = step;
+    t += 1;
+    const float num_steps = AsFloat(t);
+    const float alpha_t = alpha * std::sqrt(1 - std::pow(beta2, num_steps)) / (1 - std::pow(beta1, num_steps));
+
+    if (CanUpdateOnHost({&params, &grads, &ms, &vs})) {
+        for (size_t i = 0; i < params.size(); ++i) {
+            CHECK_EQ(params[i].shape(), grads[i].shape());
+            float* p = RawFloats(params[i]);
+            const float* g = RawFloats(grads[i]);
+            float* m = RawFloats(ms[i]);
+            float* v = RawFloats(vs[i]);
+            const int64_t size = params[i].GetTotalSize();
+            for (int64_t j = 0; j < size; ++j) {
+                const float d = g[j] * scale + weight_decay * p[j];
+                m[j] += (1 - beta1) * (d - m[j]);
+                v[j] += (1 - beta2) * (d * d - v[j]);
+                p[j] -= alpha_t * m[j] / (std::sqrt(v[j]) + eps);
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < params.size(); ++i) {
+        chainerx::Array p = params[i];
+        chainerx::Array d = grads[i] * scale;
+        if (weight_decay) d += p * weight_decay;
+        chainerx::Array m = ms[i];
+        chainerx::Array v = vs[i];
+        m += (d - m) * (1 - beta1);
+        v += (d * d - v) * (1 - beta2);
+        p -= m / (chainerx::Sqrt(v) + eps) * alpha_t;
+    }
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -32,7 +32,7 @@ std::tuple<chainerx::Array, XCVMOpaque*> MaxPoolOp::RunImpl(XCVMState* st, const
     std::unique_ptr<chainerx::MaxPoolForwardBackward> fb(
             x.device().GetMaxPoolForwardBackward(kernel_shape, ComplementStride(strides, x), ComplementPad(pads, x), cover_all));
     chainerx::Array out = fb->Forward(x);
-    XCVMOpaque* ctx = new BackwardContext<chainerx::MaxPoolForwardBackward>(std::move(fb));
+    XCVMOpaque* ctx = this->ctx >= 0 ? new BackwardContext<chainerx::MaxPoolForwardBackward>(std::move(fb)) : nullptr;
     return std::tie(out, ctx);
 }
 
@@ -42,7 +42,7 @@ std::tuple<chainerx::Array, XCVMOpaque*> AveragePoolOp::RunImpl(XCVMState* st, c
     std::unique_ptr<chainerx::AveragePoolForwardBackward> fb(
             x.device().GetAveragePoolForwardBackward(kernel_shape, ComplementStride(strides, x), ComplementPad(pads, x), pad_mode));
     chainerx::Array out = fb->Forward(x);
-    XCVMOpaque* ctx = new BackwardContext<chainerx::AveragePoolForwardBackward>(std::move(fb));
+    XCVMOpaque* ctx = this->ctx >= 0 ? new BackwardContext<chainerx::AveragePoolForwardBackward>(std::move(fb)) : nullptr;
     return std::tie(out, ctx);
 }
 
@@ -1,4 +1,8 @@
+#include <cmath>
+#include <tuple>
+
 #include <chainerx/backprop_mode.h>
+#include <chainerx/native/native_device.h>
 #include <chainerx/routines/creation.h>
 #include <chainerx/routines/linalg.h>
 #include <chainerx/routines/logic.h>
@@ -34,6 +38,10 @@ public:
         return has_mask_;
     }
 
+    const chainerx::Array& sequence_mask() const {
+        return sequence_mask_;
+    }
+
     void UpdateState(int time, const chainerx::Array& new_value, chainerx::Array* out) {
         if (has_mask_) {
             CHECK_LE(0, time);
@@ -61,6 +69,119 @@ private:
     chainerx::Array pmask_, nmask_;
 };
 
+// Computes the input projection `x * wt + b` of all timesteps by a
+// single GEMM as it has no recurrent dependency. Returns an array of
+// [seq_length, batch_size, wt.shape()[1]].
+chainerx::Array ProjectInputs(const chainerx::Array& x, const chainerx::Array& wt, const nonstd::optional<chainerx::Array>& b) {
+    int64_t seq_length = x.shape()[0];
+    int64_t batch_size = x.shape()[1];
+    chainerx::Array xw = chainerx::Dot(chainerx::Reshape(x, {seq_length * batch_size, x.shape()[2]}), wt);
+    if (b.has_value()) xw = xw + *b;
+    return chainerx::Reshape(xw, {seq_length, batch_size, wt.shape()[1]});
+}
+
+// Applies activations of an LSTM cell to pre-activation `gates`
+// ([batch_size, 4 * hidden_size]) in a single pass and updates `c`,
+// `h`, and `y` in place. Rows whose `mask` is zero are left as is.
+template <typename T>
+void LSTMCellForward(
+        const T* gates, const T* pi, const T* po, const T* pf, const T* mask, int64_t batch_size, int64_t hidden_size, T* c, T* h, T* y) {
+    auto sigmoid = [](T v) { return 1 / (1 + std::exp(-v)); };
+    for (int64_t b = 0; b < batch_size; ++b) {
+        if (mask && mask[b] == 0) continue;
+        const T* g = gates + b * 4 * hidden_size;
+        T* cb = c + b * hidden_size;
+        T* hb = h + b * hidden_size;
+        T* yb = y + b * hidden_size;
+        for (int64_t j = 0; j < hidden_size; ++j) {
+            T i = g[j];
+            T o = g[hidden_size + j];
+            T f = g[hidden_size * 2 + j];
+            T nc = std::tanh(g[hidden_size * 3 + j]);
+            if (pi) {
+                i += pi[j] * cb[j];
+                f += pf[j] * cb[j];
+                o += po[j] * cb[j];
+            }
+            nc = sigmoid(f) * cb[j] + sigmoid(i) * nc;
+            cb[j] = nc;
+            hb[j] = yb[j] = sigmoid(o) * std::tanh(nc);
+        }
+    }
+}
+
+// An LSTM without backward on the native device. Only the GEMMs go
+// through ChainerX and each timestep runs `LSTMCellForward` instead of
+// a dozen element-wise ops with temporaries.
+template <typename T>
+std::tuple<chainerx::Array, chainerx::Array, chainerx::Array> FusedLSTM(
+        const chainerx::Array& x,
+        const chainerx::Array& w,
+        const chainerx::Array& r,
+        const nonstd::optional<chainerx::Array>& b,
+        const nonstd::optional<chainerx::Array>& sequence_lens,
+        const nonstd::optional<chainerx::Array>& initial_h,
+        const nonstd::optional<chainerx::Array>& initial_c,
+        const nonstd::optional<chainerx::Array>& p,
+        int direction) {
+    int64_t seq_length = x.shape()[0];
+    int64_t batch_size = x.shape()[1];
+    CHECK_EQ(0, w.shape()[1] % 4);
+    int64_t hidden_size = w.shape()[1] / 4;
+    int64_t num_direction = w.shape()[0];
+    CHECK_EQ(direction == 2 ? 2 : 1, num_direction);
+
+    SequenceLengthMask mask(sequence_lens, x.dtype(), seq_length, batch_size);
+    chainerx::Array mask_array;
+    if (mask.has_mask()) mask_array = chainerx::AsContiguous(mask.sequence_mask());
+
+    chainerx::Array output = chainerx::Zeros({seq_length, num_direction, batch_size, hidden_size}, x.dtype());
+    chainerx::Array hs = initial_h.has_value() ? initial_h->Copy() : chainerx::Zeros({num_direction, batch_size, hidden_size}, x.dtype());
+    chainerx::Array cs = initial_c.has_value() ? initial_c->Copy() : chainerx::Zeros({num_direction, batch_size, hidden_size}, x.dtype());
+
+    for (int64_t d = 0; d < num_direction; ++d) {
+        chainerx::Array wt = chainerx::Transpose(w.At({d}));
+        chainerx::Array rt = chainerx::Transpose(r.At({d}));
+        nonstd::optional<chainerx::Array> bm;
+        if (b.has_value()) {
+            chainerx::Array bs = b->At({d});
+            bm = bs.At({chainerx::Slice(0, 4 * hidden_size)}) + bs.At({chainerx::Slice(4 * hidden_size, 8 * hidden_size)});
+        }
+        chainerx::Array ps;
+        const T* pi = nullptr;
+        const T* po = nullptr;
+        const T* pf = nullptr;
+        if (p.has_value()) {
+            ps = chainerx::AsContiguous(p->At({d}));
+            pi = static_cast<const T*>(RawStartPtr(ps));
+            po = pi + hidden_size;
+            pf = pi + hidden_size * 2;
+        }
+
+        chainerx::Array h = hs.At({d});
+        chainerx::Array c = cs.At({d});
+        chainerx::Array xw = ProjectInputs(x, wt, bm);
+        for (int64_t t = 0; t < seq_length; ++t) {
+            int64_t time = t;
+            if (direction == 1 || d == 1) time = seq_length - t - 1;
+            chainerx::Array gates = chainerx::AsContiguous(xw.At({time}) + chainerx::Dot(h, rt));
+            const T* m = mask.has_mask() ? static_cast<const T*>(RawStartPtr(mask_array)) + time * batch_size : nullptr;
+            LSTMCellForward<T>(
+                    static_cast<const T*>(RawStartPtr(gates)),
+                    pi,
+                    po,
+                    pf,
+                    m,
+                    batch_size,
+                    hidden_size,
+                    static_cast<T*>(RawStartPtr(c)),
+                    static_cast<T*>(RawStartPtr(h)),
+                    static_cast<T*>(RawStartPtr(output.At({time, d}))));
+        }
+    }
+    return std::make_tuple(output, hs, cs);
+}
+
 }  // namespace
 
 std::tuple<chainerx::Array, chainerx::Array> RNNOp::RunImpl(
@@ -90,7 +211,7 @@ std::tuple<chainerx::Array, chainerx::Array> RNNOp::RunImpl(
 
     chainerx::Array wt = chainerx::Transpose(chainerx::Squeeze(w, {0}));
     chainerx::Array rt = chainerx::Transpose(chainerx::Squeeze(r, {0}));
-    chainerx::Array bm;
+    nonstd::optional<chainerx::Array> bm;
     if (b.has_value()) {
         chainerx::Array bs = chainerx::Squeeze(b.value(), {0});
         chainerx::Array b1 = bs.At({chainerx::Slice(0, hidden_size)});
@@ -102,13 +223,10 @@ std::tuple<chainerx::Array, chainerx::Array> RNNOp::RunImpl(
 
     SequenceLengthMask mask(sequence_lens, x.dtype(), seq_length, batch_size);
 
+    chainerx::Array xw = ProjectInputs(x, wt, bm);
     chainerx::Array output = chainerx::Zeros({seq_length, batch_size, hidden_size}, x.dtype());
     for (int64_t time = 0; time < x.shape()[0]; ++time) {
-        chainerx::Array cur_x = x.At({time});
-        chainerx::Array nh = chainerx::Dot(cur_x, wt) + chainerx::Dot(h, rt);
-        if (b.has_value()) {
-            nh += bm;
-        }
+        chainerx::Array nh = xw.At({time}) + chainerx::Dot(h, rt);
         mask.UpdateState(time, chainerx::Tanh(nh), &h);
         output.At({time}) += h;
     }
@@ -156,19 +274,19 @@ std::tuple<chainerx::Array, chainerx::Array> GRUOp::RunImpl(
     for (int d = 0; d < num_direction; ++d) {
         chainerx::Array ws = w.At({d});
         chainerx::Array rs = r.At({d});
-        chainerx::Array gates_w = chainerx::Transpose(ws.At({chainerx::Slice(0, 2 * hidden_size)}));
-        chainerx::Array w_h = chainerx::Transpose(ws.At({chainerx::Slice(2 * hidden_size, 3 * hidden_size)}));
         chainerx::Array gates_r = chainerx::Transpose(rs.At({chainerx::Slice(0, 2 * hidden_size)}));
         chainerx::Array r_h = chainerx::Transpose(rs.At({chainerx::Slice(2 * hidden_size, 3 * hidden_size)}));
-        chainerx::Array gates_b;
-        chainerx::Array w_bh;
+        nonstd::optional<chainerx::Array> xb;
         chainerx::Array r_bh;
         if (b.has_value()) {
             chainerx::Array bs = b->At({d});
-            gates_b = bs.At({chainerx::Slice(0, 2 * hidden_size)}) + bs.At({chainerx::Slice(3 * hidden_size, 5 * hidden_size)});
-            w_bh = bs.At({chainerx::Slice(2 * hidden_size, 3 * hidden_size)});
+            chainerx::Array gates_b =
+                    bs.At({chainerx::Slice(0, 2 * hidden_size)}) + bs.At({chainerx::Slice(3 * hidden_size, 5 * hidden_size)});
+            chainerx::Array w_bh = bs.At({chainerx::Slice(2 * hidden_size, 3 * hidden_size)});
+            xb = chainerx::Concatenate({gates_b, w_bh}, 0);
             r_bh = bs.At({chainerx::Slice(5 * hidden_size, 6 * hidden_size)});
         }
+        chainerx::Array xws = ProjectInputs(x, chainerx::Transpose(ws), xb);
         chainerx::Array h = initial_h.has_value() ? initial_h->At({d}) : chainerx::Zeros({batch_size, hidden_size}, x.dtype());
 
         chainerx::Array output = chainerx::Zeros({seq_length, batch_size, hidden_size}, x.dtype());
@@ -176,26 +294,22 @@ std::tuple<chainerx::Array, chainerx::Array> GRUOp::RunImpl(
             int64_t time = t;
             if (direction == 1 || d == 1) time = x.shape()[0] - t - 1;
 
-            chainerx::Array cur_x = x.At({time});
-            chainerx::Array gates = chainerx::Dot(cur_x, gates_w) + chainerx::Dot(h, gates_r);
-            if (b.has_value()) {
-                gates += gates_b;
-            }
+            chainerx::Array xw = xws.At({time});
+            chainerx::Array gates = xw.At({chainerx::Slice(), chainerx::Slice(0, 2 * hidden_size)}) + chainerx::Dot(h, gates_r);
             chainerx::Array z = gates.At({chainerx::Slice(), chainerx::Slice(0, hidden_size)});
             chainerx::Array r = gates.At({chainerx::Slice(), chainerx::Slice(hidden_size, 2 * hidden_size)});
             z = Sigmoid(z);
             r = Sigmoid(r);
-            chainerx::Array xw = chainerx::Dot(cur_x, w_h);
+            chainerx::Array xw_h = xw.At({chainerx::Slice(), chainerx::Slice(2 * hidden_size, 3 * hidden_size)});
             chainerx::Array nh;
             if (linear_before_reset) {
                 chainerx::Array hr = chainerx::Dot(h, r_h);
                 if (b.has_value()) hr += r_bh;
-                nh = xw + r * hr;
+                nh = xw_h + r * hr;
             } else {
-                nh = xw + chainerx::Dot(r * h, r_h);
+                nh = xw_h + chainerx::Dot(r * h, r_h);
                 if (b.has_value()) nh += r_bh;
             }
-            if (b.has_value()) nh += w_bh;
             nh = chainerx::Tanh(nh);
             mask.UpdateState(time, (1 - z) * nh + z * h, &h);
             output.At({time}) += h;
@@ -236,10 +350,28 @@ std::tuple<chainerx::Array, chainerx::Array, chainerx::Array, XCVMOpaque*> LSTMO
     }
 #endif  // CHAINER_COMPILER_ENABLE_CUDNN
 
+    // The fused cell has no backward so it is used only when nobody
+    // consumes the backward context.
+    if (ctx < 0 && dynamic_cast<const chainerx::native::NativeDevice*>(&x.device()) &&
+        (x.dtype() == chainerx::Dtype::kFloat32 || x.dtype() == chainerx::Dtype::kFloat64)) {
+        chainerx::Array y, y_h, y_c;
+        if (x.dtype() == chainerx::Dtype::kFloat32) {
+            std::tie(y, y_h, y_c) = FusedLSTM<float>(x, w, r, b, sequence_lens, initial_h, initial_c, p, direction);
+        } else {
+            std::tie(y, y_h, y_c) = FusedLSTM<double>(x, w, r, b, sequence_lens, initial_h, initial_c, p, direction);
+        }
+        return std::make_tuple(y, y_h, y_c, static_cast<XCVMOpaque*>(nullptr));
+    }
+
     std::vector<chainerx::Array> xs = {x, w, r};
     if (b.has_value()) xs.push_back(*b);
-    std::unique_ptr<BackwardContext> bwd(new BackwardContext("LSTM", xs));
-    chainerx::ForceBackpropModeScope bp_scope{bwd->backprop_id()};
+    // Do not record the backprop graph unless someone runs LSTMGrad.
+    std::unique_ptr<BackwardContext> bwd;
+    std::unique_ptr<chainerx::ForceBackpropModeScope> bp_scope;
+    if (ctx >= 0) {
+        bwd.reset(new BackwardContext("LSTM", xs));
+        bp_scope.reset(new chainerx::ForceBackpropModeScope{bwd->backprop_id()});
+    }
     // X: [seq_length, batch_size, input_size]
     // W: [num_directions, 4 * hidden_size, input_size]
     // R: [num_directions, 4 * hidden_size, hidden_size]
@@ -271,7 +403,7 @@ std::tuple<chainerx::Array, chainerx::Array, chainerx::Array, XCVMOpaque*> LSTMO
         chainerx::Array h = initial_h.has_value() ? initial_h->At({d}) : chainerx::Zeros({batch_size, hidden_size}, x.dtype());
         chainerx::Array c = initial_c.has_value() ? initial_c->At({d}) : chainerx::Zeros({batch_size, hidden_size}, x.dtype());
         std::vector<chainerx::ArrayIndex> indices(2, chainerx::Slice());
-        chainerx::Array bm;
+        nonstd::optional<chainerx::Array> bm;
         if (b.has_value()) {
             chainerx::Array bs = b->At({d});
             chainerx::Array b1 = bs.At({chainerx::Slice(0, 4 * hidden_size)});
@@ -286,15 +418,12 @@ std::tuple<chainerx::Array, chainerx::Array, chainerx::Array, XCVMOpaque*> LSTMO
             pf = ps.At({chainerx::Slice(2 * hidden_size, 3 * hidden_size)});
         }
 
+        chainerx::Array xw = ProjectInputs(x, wt, bm);
         std::vector<chainerx::Array> outs(seq_length);
         for (int64_t t = 0; t < x.shape()[0]; ++t) {
             int64_t time = t;
             if (direction == 1 || d == 1) time = x.shape()[0] - t - 1;
-            chainerx::Array cur_x = x.At({time});
-            chainerx::Array gates = chainerx::Dot(cur_x, wt) + chainerx::Dot(h, rt);
-            if (b.has_value()) {
-                gates = gates + bm;
-            }
+            chainerx::Array gates = xw.At({time}) + chainerx::Dot(h, rt);
             indices[1] = chainerx::Slice({0, hidden_size});
             chainerx::Array i = gates.At(indices);
             indices[1] = chainerx::Slice({hidden_size, hidden_size * 2});
@@ -331,13 +460,13 @@ std::tuple<chainerx::Array, chainerx::Array, chainerx::Array, XCVMOpaque*> LSTMO
         chainerx::Array output = chainerx::Reshape(outputs[0], {seq_length, 1, batch_size, hidden_size});
         chainerx::Array h = chainerx::Reshape(hs[0], {1, hs[0].shape()[0], hs[0].shape()[1]});
         chainerx::Array c = chainerx::Reshape(cs[0], {1, cs[0].shape()[0], cs[0].shape()[1]});
-        bwd->SetOutput({output});
+        if (bwd) bwd->SetOutput({output});
         return std::make_tuple(output, h, c, bwd.release());
     } else {
         chainerx::Array output = chainerx::Stack({outputs[0], outputs[1]}, 1);
         chainerx::Array h = chainerx::Stack({hs[0], hs[1]}, 0);
         chainerx::Array c = chainerx::Stack({cs[0], cs[1]}, 0);
-        bwd->SetOutput({output});
+        if (bwd) bwd->SetOutput({output});
         return std::make_tuple(output, h, c, bwd.release());
     }
 }
@@ -48,6 +48,12 @@ chainerx::Array SequenceLookupOp::RunImpl(XCVMState* st, const XCVMSequence& seq
     return seq[i].GetArray();
 }
 
+chainerx::Array SequenceLookupScalarOp::RunImpl(XCVMState* st, const XCVMSequence& seq, int64_t index) {
+    if (index < 0) index += seq.size();
+    CHECK_LT(index, seq.size());
+    return seq[index].GetArray();
+}
+
 void SequenceLookupGradOp::RunImpl(
         XCVMState* st, const chainerx::Array& gy, const chainerx::Array& size, const chainerx::Array& index, XCVMSequence* gx) {
     int64_t i = static_cast<int64_t>(chainerx::AsScalar(index));
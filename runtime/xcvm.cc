@@ -48,8 +48,81 @@ void CheckType(XCVMState* st, const XCVMOp* op) {
     }
 }
 
+bool IsJump(XCInstructionProto::Op op) {
+    switch (op) {
+        case XCInstructionProto::Jmp:
+        case XCInstructionProto::JmpTrue:
+        case XCInstructionProto::JmpFalse:
+        case XCInstructionProto::ScalarJmpTrue:
+        case XCInstructionProto::ScalarJmpFalse:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Ops which modify their input sequences in place.
+bool IsInPlaceSequenceOp(XCInstructionProto::Op op) {
+    switch (op) {
+        case XCInstructionProto::SequenceClear:
+        case XCInstructionProto::SequenceAppend:
+        case XCInstructionProto::SequencePop:
+        case XCInstructionProto::SequenceMove:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::vector<int> GetInputIds(const XCInstructionProto& inst) {
+    std::vector<int> ids;
+    for (const XCValueProto& value : inst.inputs()) {
+        switch (value.type()) {
+            case XCValueProto::ARRAY:
+                if (value.array() >= 0) ids.push_back(value.array());
+                break;
+            case XCValueProto::ARRAY_LIST:
+                ids.insert(ids.end(), RANGE(value.array_list()));
+                break;
+            case XCValueProto::SEQUENCE:
+                ids.push_back(value.sequence());
+                break;
+            case XCValueProto::OPAQUE:
+                ids.push_back(value.opaque());
+                break;
+            case XCValueProto::SCALAR:
+                ids.push_back(value.scalar());
+                break;
+            default:
+                break;
+        }
+    }
+    return ids;
+}
+
+std::vector<int> GetOutputIds(const XCInstructionProto& inst) {
+    std::vector<int> ids;
+    for (int id : inst.outputs()) {
+        if (id >= 0) ids.push_back(id);
+    }
+    if (IsInPlaceSequenceOp(inst.op())) {
+        for (const XCValueProto& value : inst.inputs()) {
+            if (value.type() == XCValueProto::SEQUENCE) ids.push_back(value.sequence());
+        }
+    }
+    return ids;
+}
+
 }  // namespace
 
+// Instructions to run for a set of requested outputs.
+struct XCVM::Plan {
+    // Whether each instruction should be run.
+    std::vector<bool> run;
+    // Variables freed right after each instruction.
+    std::vector<std::vector<int>> frees;
+};
+
 XCVMOptions::XCVMOptions() {
     int num_ops = 1;
     while (XCInstructionProto::Op_IsValid(num_ops)) {
@@ -81,15 +154,117 @@ InOuts XCVM::Run(const InOuts& program_inputs, const XCVMOptions& options) {
     return state.GetOutputs();
 }
 
+InOuts XCVM::Run(const InOuts& program_inputs, const XCVMOptions& options, const std::set<std::string>& output_names) {
+    if (output_names.empty()) return Run(program_inputs, options);
+    const Plan& plan = GetPlan(output_names);
+    XCVMState state(options, num_variables_, program_inputs);
+    Run(&state, &plan);
+    return state.GetOutputs();
+}
+
+const XCVM::Plan& XCVM::GetPlan(const std::set<std::string>& output_names) {
+    std::lock_guard<std::mutex> lock(plans_mu_);
+    std::unique_ptr<Plan>& plan = plans_[output_names];
+    if (plan) return *plan;
+
+    const int num_insts = program_.size();
+    std::vector<bool> run(num_insts);
+    std::vector<bool> needed(num_variables_);
+    std::set<std::string> found_outputs;
+    bool has_jumps = false;
+    // Iterate until the set of needed variables converges, as
+    // backward jumps may use values defined later.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int pc = num_insts - 1; pc >= 0; --pc) {
+            if (run[pc]) continue;
+            const XCInstructionProto& inst = program_[pc]->instruction();
+            if (inst.op() == XCInstructionProto::Free) continue;
+
+            bool keep = false;
+            if (IsJump(inst.op())) {
+                has_jumps = true;
+                keep = true;
+            } else if (inst.op() == XCInstructionProto::Out) {
+                keep = output_names.count(inst.inputs(0).s());
+                if (keep) found_outputs.insert(inst.inputs(0).s());
+            } else {
+                const std::vector<int> outputs = GetOutputIds(inst);
+                // Ops without outputs have side effects, e.g., updates of parameters.
+                keep = outputs.empty();
+                for (int id : outputs) keep |= needed[id];
+            }
+            if (!keep) continue;
+
+            run[pc] = true;
+            changed = true;
+            for (int id : GetInputIds(inst)) needed[id] = true;
+            if (IsInPlaceSequenceOp(inst.op())) {
+                for (int id : GetOutputIds(inst)) needed[id] = true;
+            }
+        }
+    }
+    for (const std::string& name : output_names) {
+        CHECK(found_outputs.count(name)) << "Unknown output: " << name;
+    }
+
+    plan.reset(new Plan());
+    plan->run = run;
+    plan->frees.resize(num_insts);
+    if (has_jumps) {
+        // A jump target may be between the last use of a value and
+        // its Free, so Frees stay where they are. Values not defined
+        // by the subset must not be freed.
+        std::vector<bool> defined(num_variables_);
+        for (int pc = 0; pc < num_insts; ++pc) {
+            if (!run[pc]) continue;
+            for (int id : GetOutputIds(program_[pc]->instruction())) defined[id] = true;
+        }
+        for (int pc = 0; pc < num_insts; ++pc) {
+            const XCInstructionProto& inst = program_[pc]->instruction();
+            if (inst.op() == XCInstructionProto::Free && defined[inst.inputs(0).array()]) plan->run[pc] = true;
+        }
+        return *plan;
+    }
+
+    // Free each value right after its last reference in the subset.
+    std::vector<int> last_refs(num_variables_, -1);
+    for (int pc = 0; pc < num_insts; ++pc) {
+        const XCInstructionProto& inst = program_[pc]->instruction();
+        if (inst.op() != XCInstructionProto::Free) {
+            if (!run[pc]) continue;
+            for (int id : GetInputIds(inst)) last_refs[id] = pc;
+            for (int id : GetOutputIds(inst)) last_refs[id] = pc;
+            continue;
+        }
+        const int id = inst.inputs(0).array();
+        if (last_refs[id] < 0) continue;
+        plan->frees[last_refs[id]].push_back(id);
+        last_refs[id] = -1;
+    }
+    return *plan;
+}
+
 void XCVM::Run(XCVMState* state) {
+    Run(state, nullptr);
+}
+
+void XCVM::Run(XCVMState* state, const Plan* plan) {
     state->SetProgram(&program_);
     const XCVMOptions& options = state->options();
     int64_t peak_usage = 0;
+    const bool instrumented = options.trace_level || options.check_nans || options.check_infs;
+    void (XCVMOp::*run_op)(XCVMState*) = instrumented ? &XCVMOp::RunInstrumented : &XCVMOp::Run;
 
     while (true) {
         int pc = state->pc();
         if (pc >= program_.size()) break;
 
+        if (plan && !plan->run[pc]) {
+            state->set_pc(pc + 1);
+            continue;
+        }
+
         XCVMOp* op = program_[pc].get();
 
         {
@@ -98,7 +273,7 @@ void XCVM::Run(XCVMState* state) {
             nvtxRangePush(op->name().c_str());
 #endif
             try {
-                op->Run(state);
+                (op->*run_op)(state);
             } catch (...) {
                 std::cerr << "Exception in " << op->debug_info() << std::endl;
                 throw;
@@ -114,12 +289,20 @@ void XCVM::Run(XCVMState* state) {
             CheckType(state, op);
         }
 
+        if (options.after_op_hook) {
+            options.after_op_hook(*op, state);
+        }
+
         if (options.dump_memory_usage && options.base_memory_usage >= 0) {
             int64_t bytes = options.base_memory_usage - GetMemoryUsageInBytes();
             int64_t mbs = bytes / 1000 / 1000;
             peak_usage = std::max(mbs, peak_usage);
             std::cerr << " Memory usage: " << mbs << "MB" << std::endl;
         }
+
+        if (plan) {
+            for (int id : plan->frees[pc]) state->FreeVar(id);
+        }
     }
 
     if (options.dump_memory_usage) {
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -40,14 +43,27 @@ public:
     int64_t base_memory_usage{0};
 
     ChromeTracingEmitter* chrome_tracing{nullptr};
+
+    // Called after each instruction is executed. This can be used to
+    // collect statistics of values, e.g., ranges for calibration.
+    std::function<void(const XCVMOp& op, XCVMState* st)> after_op_hook;
 };
 
+// The entry point of a program compiled to C++ by xcvm::EmitCpp, which
+// can be looked up by this name in the shared library.
+typedef void (*AOTEntryPoint)(const InOuts& inputs, const XCVMOptions& options, InOuts* outputs);
+constexpr char kAOTEntryPointName[] = "chainer_compiler_aot_run";
+
 class XCVM {
 public:
     explicit XCVM(const XCProgramProto& program);
     ~XCVM();
 
     InOuts Run(const InOuts& program_inputs, const XCVMOptions& options);
+    // Runs only instructions needed to compute `output_names`. Inputs
+    // which are not needed can be omitted. All outputs are computed
+    // if `output_names` is empty.
+    InOuts Run(const InOuts& program_inputs, const XCVMOptions& options, const std::set<std::string>& output_names);
     void Run(XCVMState* state);
 
     int num_variables() const {
@@ -55,8 +71,16 @@ public:
     }
 
 private:
+    struct Plan;
+
+    const Plan& GetPlan(const std::set<std::string>& output_names);
+    void Run(XCVMState* state, const Plan* plan);
+
     std::vector<std::unique_ptr<XCVMOp>> program_;
     int num_variables_;
+
+    std::mutex plans_mu_;
+    std::map<std::set<std::string>, std::unique_ptr<Plan>> plans_;
 };
 
 }  // namespace runtime
@@ -6,6 +6,7 @@ OPTIONAL_ARRAY = 'OPTIONAL_ARRAY'
 ARRAY_LIST = 'ARRAY_LIST'
 SEQUENCE = 'SEQUENCE'
 OPAQUE = 'OPAQUE'
+SCALAR = 'SCALAR'
 INT = 'INT'
 FLOAT = 'FLOAT'
 INTS = 'INTS'
@@ -14,7 +15,7 @@ LONGS = 'LONGS'
 DOUBLES = 'DOUBLES'
 
 ARG_TYPES = [
-    ARRAY, OPTIONAL_ARRAY, ARRAY_LIST, SEQUENCE, OPAQUE
+    ARRAY, OPTIONAL_ARRAY, ARRAY_LIST, SEQUENCE, OPAQUE, SCALAR
 ]
 
 FIELD_TYPES = [
@@ -34,7 +35,7 @@ class ValueInfo(_ValueInfo):
         return self.typ in [INTS, ARRAY_LIST, LONGS, DOUBLES]
 
     def c_type(self):
-        if self.typ in [ARRAY, OPTIONAL_ARRAY, INT, SEQUENCE, OPAQUE]:
+        if self.typ in [ARRAY, OPTIONAL_ARRAY, INT, SEQUENCE, OPAQUE, SCALAR]:
             return 'int'
         elif self.typ == FLOAT:
             return 'float'
@@ -60,7 +61,7 @@ class ValueInfo(_ValueInfo):
         return ctyp
 
     def c_codegen_type(self):
-        if self.typ in (ARRAY, OPTIONAL_ARRAY, SEQUENCE, OPAQUE):
+        if self.typ in (ARRAY, OPTIONAL_ARRAY, SEQUENCE, OPAQUE, SCALAR):
             return 'XCVMValue'
         elif self.typ == ARRAY_LIST:
             return 'std::vector<XCVMValue>'
@@ -88,6 +89,8 @@ class ValueInfo(_ValueInfo):
             return 'array_list'
         elif self.typ == OPAQUE:
             return 'opaque'
+        elif self.typ == SCALAR:
+            return 'scalar'
         else:
             raise RuntimeError('Unknown type: %s' % self.typ)
 
@@ -112,6 +115,11 @@ def Opaque(name):
     return ValueInfo(OPAQUE, name)
 
 
+# An int64 held in the scalar register file of XCVMState.
+def Scalar(name):
+    return ValueInfo(SCALAR, name)
+
+
 def Int(name):
     return ValueInfo(INT, name)
 
@@ -143,6 +151,8 @@ def sigil(typ):
         return '@'
     elif typ == OPAQUE:
         return '*'
+    elif typ == SCALAR:
+        return '%'
     else:
         raise RuntimeError('Not a varaible: %s' % typ)
 
@@ -206,6 +216,7 @@ XC_OPS = [
     ('Shape', [Array('data')], ['shape']),
     ('Size', [Array('data')], ['size']),
     ('Reshape', [Array('data'), Array('shape')], ['reshaped']),
+    ('StaticReshape', [Array('data'), Ints('shape')], ['reshaped']),
     ('Expand', [Array('input'), Array('shape')], ['output']),
     ('Squeeze', [Array('data'), Ints('axes')], ['squeezed']),
     ('Unsqueeze', [Array('data'), Ints('axes')], ['expanded']),
@@ -233,8 +244,6 @@ XC_OPS = [
     ('Softmax', [Array('input'), Int('axis')], ['output']),
     ('LogSoftmax', [Array('input'), Int('axis')], ['output']),
 
-    ('Dropout', [Array('data'), Float('ratio')], ['output', 'mask']),
-
     ('Pad', [Array('data'), Ints('pads'), Float('value')], ['output']),
     ('MaxPool',
      [Array('x'), Ints('kernel_shape'), Ints('strides'), Ints('pads'),
@@ -321,6 +330,32 @@ XC_OPS = [
     ('JmpTrue', [Array('cond'), Int('pc')], []),
     ('JmpFalse', [Array('cond'), Int('pc')], []),
 
+    # Scalar ops for loop control, which do not allocate arrays.
+    ('ScalarConstant', [Int('value')], [Scalar('output')]),
+    ('ScalarFromArray', [Array('input')], [Scalar('output')]),
+    ('ScalarToArray', [Scalar('input'), Int('dtype')], ['output']),
+    ('ScalarAdd', [Scalar('a'), Scalar('b')], [Scalar('c')]),
+    ('ScalarSub', [Scalar('a'), Scalar('b')], [Scalar('c')]),
+    ('ScalarMul', [Scalar('a'), Scalar('b')], [Scalar('c')]),
+    ('ScalarLess', [Scalar('a'), Scalar('b')], [Scalar('c')]),
+    ('ScalarEqual', [Scalar('a'), Scalar('b')], [Scalar('c')]),
+    ('ScalarJmpTrue', [Scalar('cond'), Int('pc')], []),
+    ('ScalarJmpFalse', [Scalar('cond'), Int('pc')], []),
+
+    # Adds `grads` to `accums` in place.
+    ('AccumulateGrads', [ArrayList('accums'), ArrayList('grads')], []),
+    # Optimizers which update `params` and their states in place.
+    ('MomentumSGDUpdate',
+     [Array('lr'), Array('grad_scale'), ArrayList('params'),
+      ArrayList('grads'), ArrayList('velocities'),
+      Float('momentum'), Float('weight_decay')],
+     []),
+    ('AdamUpdate',
+     [Array('lr'), Array('grad_scale'), Array('step'), ArrayList('params'),
+      ArrayList('grads'), ArrayList('ms'), ArrayList('vs'),
+      Float('beta1'), Float('beta2'), Float('eps'), Float('weight_decay')],
+     []),
+
     ('ElementWiseNvrtc',
      [ArrayList('inputs'), Int('num_outputs'),
       String('code'), Int('fusion_id')],
@@ -328,6 +363,7 @@ XC_OPS = [
 ]
 
 XC_CUSTOM_FIELD_OPS = [
+    ('Dropout', [Array('data'), Float('ratio')], ['output', 'mask']),
     ('TVM',
      [ArrayList('inputs'), Int('num_outputs'),
       String('dso_filename'), String('func_name'), Ints('output_shape')],
@@ -337,6 +373,8 @@ XC_CUSTOM_FIELD_OPS = [
 XC_SEQ_OPS = [
     ('SequenceCreate', [], [Sequence('output')]),
     ('SequenceLookup', [Sequence('seq'), Array('index')], [Array('output')]),
+    ('SequenceLookupScalar', [Sequence('seq'), Scalar('index')],
+     [Array('output')]),
     ('SequenceLookupGrad', [Array('gy'), Array('size'), Array('index')],
      [Sequence('gx')]),
     ('SequenceGetSlice',
@@ -385,6 +423,7 @@ XC_GENERIC_OPS = [
 
     ('GenericLen', [Array('v')], ['len']),
     ('GenericGetItem', [Array('v'), Array('index')], ['output']),
+    ('GenericGetItemScalar', [Array('v'), Scalar('index')], ['output']),
     ('GenericGetSlice',
      [Array('v'), OptionalArray('start'),
       OptionalArray('end'), OptionalArray('step')], ['output']),
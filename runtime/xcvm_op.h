@@ -15,7 +15,10 @@ public:
     explicit XCVMOp(const XCInstructionProto& inst);
     virtual ~XCVMOp() = default;
 
+    // Runs the op without tracing or value checks.
     virtual void Run(XCVMState* state) = 0;
+    // Runs the op with tracing and checks enabled by XCVMOptions.
+    virtual void RunInstrumented(XCVMState* state) = 0;
 
     const XCInstructionProto& instruction() const {
         return inst_;
@@ -13,7 +13,7 @@ namespace chainer_compiler {
 namespace runtime {
 
 XCVMState::XCVMState(const XCVMOptions& options, int num_variables, const InOuts& inputs)
-    : pc_(0), variables_(num_variables), inputs_(inputs), options_(options) {
+    : pc_(0), variables_(num_variables), scalars_(num_variables), inputs_(inputs), options_(options) {
 }
 
 XCVMState::~XCVMState() {
@@ -33,6 +33,7 @@ nonstd::optional<chainerx::Array> XCVMState::GetOptionalArray(int index) {
 
 std::vector<chainerx::Array> XCVMState::GetArrayList(const std::vector<int>& index) {
     std::vector<chainerx::Array> vars;
+    vars.reserve(index.size());
     for (int i : index) vars.push_back(GetArray(i));
     return vars;
 }
@@ -84,6 +85,18 @@ void XCVMState::SetVar(int index, const XCVMVar& var) {
     variables_[index].reset(new XCVMVar(var));
 }
 
+int64_t XCVMState::GetScalar(int index) const {
+    CHECK_LE(0, index) << index;
+    CHECK_GT(scalars_.size(), index) << index;
+    return scalars_[index];
+}
+
+void XCVMState::SetScalar(int index, int64_t value) {
+    CHECK_LE(0, index) << index;
+    CHECK_GT(scalars_.size(), index) << index;
+    scalars_[index] = value;
+}
+
 std::string XCVMState::GetVarString(int index) {
     if (index < 0) return "null";
     CHECK_GT(variables_.size(), index) << index;
@@ -190,6 +203,7 @@ bool HasElemInVar(chainerx::Array (*pred_fn)(const chainerx::Array&), const XCVM
 
 void XCVMState::CheckNans(const std::vector<int>& inputs, const std::vector<int>& outputs) {
     for (int output : outputs) {
+        if (output < 0) continue;
         if (!HasElemInVar(chainerx::IsNan, *GetVar(output))) continue;
 
         std::cerr << "NaN detected!\n";
@@ -199,6 +213,7 @@ void XCVMState::CheckNans(const std::vector<int>& inputs, const std::vector<int>
 
 void XCVMState::CheckInfs(const std::vector<int>& inputs, const std::vector<int>& outputs) {
     for (int output : outputs) {
+        if (output < 0) continue;
         if (!HasElemInVar(chainerx::IsInf, *GetVar(output))) continue;
 
         std::cerr << "Inf detected!\n";
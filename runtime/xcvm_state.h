@@ -47,6 +47,12 @@ public:
     XCVMVar* GetVar(int index);
     void SetVar(int index, const XCVMVar& var);
 
+    // Scalar registers share indices with variables but are never
+    // freed. They hold loop counters and conditions without
+    // allocating arrays.
+    int64_t GetScalar(int index) const;
+    void SetScalar(int index, int64_t value);
+
     std::string GetVarString(int index);
     std::string GetVarListString(const std::vector<int>& indices);
 
@@ -88,6 +94,7 @@ private:
 
     int pc_;
     std::vector<std::unique_ptr<XCVMVar>> variables_;
+    std::vector<int64_t> scalars_;
     InOuts inputs_;
     InOuts outputs_;
     XCVMOptions options_;
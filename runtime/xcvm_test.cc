@@ -1,4 +1,6 @@
+#include <cmath>
 #include <iostream>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -9,6 +11,7 @@
 #include <chainerx/testing/array.h>
 
 #include <compiler/gen_xcvm_codegen.h>
+#include <runtime/chainerx_util.h>
 #include <runtime/xcvm.h>
 #include <runtime/xcvm.pb.h>
 #include <runtime/xcvm_var.h>
@@ -40,6 +43,219 @@ TEST(XCVMTest, Run) {
     EXPECT_TRUE(chainerx::AllClose(e, outputs["out"]->GetArray(), 0, 0));
 }
 
+TEST(XCVMTest, PartialRun) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in1");
+    xcvm::AddInOp(&program, 1, "in2");
+    xcvm::AddAddOp(&program, 2, 0, 1);
+    xcvm::AddMulOp(&program, 3, 0, 0);
+    xcvm::AddOutOp(&program, "sum", 2);
+    xcvm::AddOutOp(&program, "sq", 3);
+    for (int i = 0; i < 4; ++i) xcvm::AddFreeOp(&program, i);
+
+    XCVM xcvm(program);
+    // "in2" is not needed to compute "sq".
+    InOuts inputs;
+    chainerx::Array in1 = chainerx::Eye(2, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32);
+    inputs.emplace("in1", std::shared_ptr<XCVMVar>(new XCVMVar(in1 + in1)));
+    for (int i = 0; i < 2; ++i) {
+        InOuts outputs = xcvm.Run(inputs, XCVMOptions(), {"sq"});
+        ASSERT_EQ(1, outputs.size());
+        ASSERT_EQ(1, outputs.count("sq"));
+        chainerx::Array e = chainerx::testing::BuildArray({2, 2}).WithData<float>({4, 0, 0, 4});
+        EXPECT_TRUE(chainerx::AllClose(e, outputs["sq"]->GetArray(), 0, 0));
+    }
+}
+
+TEST(XCVMTest, ScalarLoop) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddScalarConstantOp(&program, 0, 0);
+    xcvm::AddScalarConstantOp(&program, 1, 1);
+    xcvm::AddScalarConstantOp(&program, 2, 5);
+    xcvm::AddScalarAddOp(&program, 0, 0, 1);
+    xcvm::AddScalarLessOp(&program, 3, 0, 2);
+    xcvm::AddScalarJmpTrueOp(&program, 3, 3);
+    xcvm::AddScalarToArrayOp(&program, 4, 0, static_cast<int>(chainerx::Dtype::kInt64));
+    xcvm::AddOutOp(&program, "out", 4);
+
+    XCVM xcvm(program);
+    InOuts outputs = xcvm.Run({}, XCVMOptions());
+    ASSERT_EQ(1, outputs.count("out"));
+    const chainerx::Array& out = outputs["out"]->GetArray();
+    EXPECT_EQ(chainerx::Dtype::kInt64, out.dtype());
+    EXPECT_EQ(5, static_cast<int64_t>(chainerx::AsScalar(out)));
+}
+
+TEST(XCVMTest, DropoutIsReproducible) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "in");
+    xcvm::AddDropoutOp(&program, 1, 2, 0, 0.5);
+    xcvm::AddOutOp(&program, "out", 1);
+
+    InOuts inputs;
+    chainerx::Array in = chainerx::Ones({100}, chainerx::Dtype::kFloat32);
+    inputs.emplace("in", std::shared_ptr<XCVMVar>(new XCVMVar(in)));
+    XCVMOptions options;
+    options.is_training = true;
+
+    // Masks only depend on the program and the number of runs.
+    XCVM xcvm1(program);
+    XCVM xcvm2(program);
+    chainerx::Array o11 = xcvm1.Run(inputs, options)["out"]->GetArray();
+    chainerx::Array o12 = xcvm1.Run(inputs, options)["out"]->GetArray();
+    chainerx::Array o21 = xcvm2.Run(inputs, options)["out"]->GetArray();
+    EXPECT_TRUE(chainerx::AllClose(o11, o21, 0, 0));
+    EXPECT_FALSE(chainerx::AllClose(o11, o12, 0, 0));
+}
+
+chainerx::Array MakeTestArray(const chainerx::Shape& shape, float seed) {
+    std::vector<float> data(shape.GetTotalSize());
+    for (size_t i = 0; i < data.size(); ++i) data[i] = 0.5f * std::sin(seed + i * 0.7f);
+    return chainerx::testing::BuildArray(shape).WithData<float>(data);
+}
+
+TEST(XCVMTest, FusedLSTMMatchesUnfused) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const int64_t seq_length = 4, batch_size = 3, input_size = 5, hidden_size = 6;
+    const char* kNames[] = {"x", "w", "r", "b", "sequence_lens", "initial_h", "initial_c", "p"};
+    InOuts inputs;
+    auto add_input = [&inputs](const char* name, const chainerx::Array& a) {
+        inputs.emplace(name, std::shared_ptr<XCVMVar>(new XCVMVar(a)));
+    };
+    add_input("x", MakeTestArray({seq_length, batch_size, input_size}, 1));
+    add_input("w", MakeTestArray({2, 4 * hidden_size, input_size}, 2));
+    add_input("r", MakeTestArray({2, 4 * hidden_size, hidden_size}, 3));
+    add_input("b", MakeTestArray({2, 8 * hidden_size}, 4));
+    add_input("sequence_lens", chainerx::testing::BuildArray({batch_size}).WithData<int32_t>({4, 2, 3}));
+    add_input("initial_h", MakeTestArray({2, batch_size, hidden_size}, 5));
+    add_input("initial_c", MakeTestArray({2, batch_size, hidden_size}, 6));
+    add_input("p", MakeTestArray({2, 3 * hidden_size}, 7));
+
+    // The fused cell is used only when the backward context is not
+    // requested, so `with_ctx` selects the unfused ChainerX path.
+    auto run = [&](bool with_ctx) {
+        XCProgramProto program;
+        for (int i = 0; i < 8; ++i) xcvm::AddInOp(&program, i, kNames[i]);
+        xcvm::AddLSTMOp(&program, 8, 9, 10, with_ctx ? 11 : -1, 0, 1, 2, 3, 4, 5, 6, 7, hidden_size, 2 /* bidirectional */);
+        xcvm::AddOutOp(&program, "y", 8);
+        xcvm::AddOutOp(&program, "y_h", 9);
+        xcvm::AddOutOp(&program, "y_c", 10);
+        XCVM xcvm(program);
+        return xcvm.Run(inputs, XCVMOptions());
+    };
+
+    InOuts fused = run(false);
+    InOuts unfused = run(true);
+    for (const char* name : {"y", "y_h", "y_c"}) {
+        const chainerx::Array& e = unfused[name]->GetArray();
+        const chainerx::Array& a = fused[name]->GetArray();
+        EXPECT_EQ(e.shape(), a.shape()) << name;
+        EXPECT_TRUE(chainerx::AllClose(e, a, 1e-5, 1e-5)) << name;
+    }
+}
+
+std::vector<float> ToFloats(const chainerx::Array& a) {
+    std::vector<float> values;
+    for (int64_t i = 0; i < a.GetTotalSize(); ++i) values.push_back(static_cast<float>(chainerx::AsScalar(a.At({i}))));
+    return values;
+}
+
+TEST(XCVMTest, MomentumSGDUpdate) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const float lr = 0.1f, grad_scale = 0.5f, momentum = 0.9f, weight_decay = 0.01f;
+    std::vector<float> p = {1.0f, -2.0f, 3.0f};
+    const std::vector<float> g = {0.5f, 0.25f, -1.0f};
+    std::vector<float> v(3, 0.0f);
+
+    chainerx::Array param = chainerx::testing::BuildArray({3}).WithData<float>(p);
+    chainerx::Array velocity = chainerx::Zeros({3}, chainerx::Dtype::kFloat32);
+    InOuts inputs;
+    inputs.emplace("lr", std::shared_ptr<XCVMVar>(new XCVMVar(MakeScalarArray(lr))));
+    inputs.emplace("grad_scale", std::shared_ptr<XCVMVar>(new XCVMVar(MakeScalarArray(grad_scale))));
+    inputs.emplace("param", std::shared_ptr<XCVMVar>(new XCVMVar(param)));
+    inputs.emplace("grad", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::testing::BuildArray({3}).WithData<float>(g))));
+    inputs.emplace("velocity", std::shared_ptr<XCVMVar>(new XCVMVar(velocity)));
+
+    XCProgramProto program;
+    xcvm::AddInOp(&program, 0, "lr");
+    xcvm::AddInOp(&program, 1, "grad_scale");
+    xcvm::AddInOp(&program, 2, "param");
+    xcvm::AddInOp(&program, 3, "grad");
+    xcvm::AddInOp(&program, 4, "velocity");
+    xcvm::AddMomentumSGDUpdateOp(&program, 0, 1, {2}, {3}, {4}, momentum, weight_decay);
+    XCVM xcvm(program);
+
+    for (int step = 0; step < 2; ++step) {
+        xcvm.Run(inputs, XCVMOptions());
+        for (size_t i = 0; i < p.size(); ++i) {
+            const float d = g[i] * grad_scale + weight_decay * p[i];
+            v[i] = momentum * v[i] - lr * d;
+            p[i] += v[i];
+        }
+        const std::vector<float> actual_p = ToFloats(param);
+        const std::vector<float> actual_v = ToFloats(velocity);
+        for (size_t i = 0; i < p.size(); ++i) {
+            EXPECT_NEAR(p[i], actual_p[i], 1e-6) << "step=" << step << " i=" << i;
+            EXPECT_NEAR(v[i], actual_v[i], 1e-6) << "step=" << step << " i=" << i;
+        }
+    }
+}
+
+TEST(XCVMTest, AdamUpdate) {
+    chainerx::Context ctx;
+    chainerx::SetGlobalDefaultContext(&ctx);
+
+    const float lr = 0.01f, grad_scale = 2.0f, beta1 = 0.9f, beta2 = 0.999f, eps = 1e-8f, weight_decay = 0.1f;
+    std::vector<float> p = {1.0f, -2.0f, 3.0f};
+    const std::vector<float> g = {0.5f, 0.25f, -1.0f};
+    std::vector<float> m(3, 0.0f), v(3, 0.0f);
+
+    chainerx::Array step = MakeScalarArray(0);
+    chainerx::Array param = chainerx::testing::BuildArray({3}).WithData<float>(p);
+    InOuts inputs;
+    inputs.emplace("lr", std::shared_ptr<XCVMVar>(new XCVMVar(MakeScalarArray(lr))));
+    inputs.emplace("grad_scale", std::shared_ptr<XCVMVar>(new XCVMVar(MakeScalarArray(grad_scale))));
+    inputs.emplace("step", std::shared_ptr<XCVMVar>(new XCVMVar(step)));
+    inputs.emplace("param", std::shared_ptr<XCVMVar>(new XCVMVar(param)));
+    inputs.emplace("grad", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::testing::BuildArray({3}).WithData<float>(g))));
+    inputs.emplace("m", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Zeros({3}, chainerx::Dtype::kFloat32))));
+    inputs.emplace("v", std::shared_ptr<XCVMVar>(new XCVMVar(chainerx::Zeros({3}, chainerx::Dtype::kFloat32))));
+
+    XCProgramProto program;
+    const char* kNames[] = {"lr", "grad_scale", "step", "param", "grad", "m", "v"};
+    for (int i = 0; i < 7; ++i) xcvm::AddInOp(&program, i, kNames[i]);
+    xcvm::AddAdamUpdateOp(&program, 0, 1, 2, {3}, {4}, {5}, {6}, beta1, beta2, eps, weight_decay);
+    XCVM xcvm(program);
+
+    for (int t = 1; t <= 2; ++t) {
+        xcvm.Run(inputs, XCVMOptions());
+        // The step counter is incremented in place.
+        EXPECT_EQ(static_cast<float>(t), static_cast<float>(chainerx::AsScalar(step)));
+        const float alpha_t = lr * std::sqrt(1 - std::pow(beta2, t)) / (1 - std::pow(beta1, t));
+        for (size_t i = 0; i < p.size(); ++i) {
+            const float d = g[i] * grad_scale + weight_decay * p[i];
+            m[i] = beta1 * m[i] + (1 - beta1) * d;
+            v[i] = beta2 * v[i] + (1 - beta2) * d * d;
+            p[i] -= alpha_t * m[i] / (std::sqrt(v[i]) + eps);
+        }
+        const std::vector<float> actual_p = ToFloats(param);
+        for (size_t i = 0; i < p.size(); ++i) EXPECT_NEAR(p[i], actual_p[i], 1e-6) << "t=" << t << " i=" << i;
+    }
+}
+
 }  // namespace
 }  // namespace runtime
 }  // namespace chainer_compiler
@@ -364,6 +364,51 @@ def gen_concat_backprop_test(test_name):
     gb.gen_test()
 
 
+def gen_concat_dynamic_backprop_test(test_name):
+    # The length of `e` depends on an input, so Concat is lowered to
+    # sequence ops and differentiated through them.
+    gb = onnx_script.GraphBuilder(test_name)
+    i = aranges(2, 3)
+    n = np.array([2, 2], np.int64)
+
+    i_v = gb.param('i', i)
+    n_v = gb.input('n', n)
+
+    e_v = gb.Expand([gb.const(np.array([[7]], np.float32)), n_v])
+    concat_v = gb.Concat([i_v, e_v], axis=1)
+    m = aranges(2, 5) + 1
+    r_v = gb.Mul([concat_v, gb.const(m)])
+    r = np.concatenate([i, np.full((2, 2), 7, np.float32)], axis=1) * m
+
+    gb.output(r_v, r)
+    gb.gradient(i_v, m[:, 0:3])
+    gb.gen_test()
+
+
+def gen_concat_static_backprop_test(test_name):
+    # Lengths along the axis are static, so Concat stays native and
+    # its gradient is a Split.
+    gb = onnx_script.GraphBuilder(test_name)
+    i = aranges(2, 3)
+    j = aranges(2, 1)
+    k = aranges(2, 2)
+
+    i_v = gb.param('i', i)
+    j_v = gb.param('j', j)
+    k_v = gb.param('k', k)
+
+    concat_v = gb.Concat([i_v, j_v, k_v], axis=-1)
+    m = aranges(2, 6) + 1
+    r_v = gb.Mul([concat_v, gb.const(m)])
+    r = np.concatenate([i, j, k], axis=-1) * m
+
+    gb.output(r_v, r)
+    gb.gradient(i_v, m[:, 0:3])
+    gb.gradient(j_v, m[:, 3:4])
+    gb.gradient(k_v, m[:, 4:6])
+    gb.gen_test()
+
+
 # Borrowed from: https://github.com/tensorflow/tensorflow/blob/master/tensorflow/cc/framework/while_gradients_test.cc
 def gen_loop_backprop_test(ii, ji, ki, gi, gj, gk):
     i, j, k = ii, ji, ki
@@ -844,6 +889,43 @@ def gen_incomplete_transpose_test(test_name):
     gb.gen_test()
 
 
+def gen_transpose_relu_transpose_test(test_name):
+    # The compiler sinks the first Transpose below Relu and cancels
+    # the pair of inverse permutations.
+    gb = onnx_script.GraphBuilder(test_name)
+
+    input = aranges(2, 3, 4, 5) - 60
+    input_v = gb.input('input', input)
+    nchw_v = gb.Transpose([input_v], perm=[0, 3, 1, 2])
+    relu_v = gb.Relu([nchw_v])
+    gb.output(gb.Transpose([relu_v], perm=[0, 2, 3, 1]),
+              np.maximum(input, 0))
+
+    gb.gen_test()
+
+
+def gen_gemm_prepack_test(test_name):
+    # Transposed weights given as initializers are prepacked at
+    # compile time for inference with --prepack_weights.
+    gb = onnx_script.GraphBuilder(test_name)
+
+    x = aranges(3, 4) / 10
+    w = aranges(5, 4) / 10 - 1
+    b = aranges(5) / 10
+    w2 = aranges(5, 4) / 10 + 1
+    x_v = gb.input('x', x)
+    w_v = gb.param('w', w)
+    b_v = gb.param('b', b)
+    w2_v = gb.param('w2', w2)
+    gb.output(gb.Gemm([x_v, w_v, b_v], transB=1, outputs=['gemm']),
+              np.dot(x, w.T) + b)
+    w2t_v = gb.Transpose([w2_v], perm=[1, 0])
+    gb.output(gb.MatMul([x_v, w2t_v], outputs=['matmul']),
+              np.dot(x, w2.T))
+
+    gb.gen_test()
+
+
 def gen_maxpool_cover_all_test(test_name):
     # A custom attribute for Chainer/ChainerX's `cover_all` parameter.
     gb = onnx_script.GraphBuilder(test_name)
@@ -1030,6 +1112,10 @@ def get_tests():
     test('extra_backprop_test', gen_backprop_test)
 
     test('extra_backprop_test_concat', gen_concat_backprop_test)
+    test('extra_backprop_test_concat_static',
+         gen_concat_static_backprop_test)
+    test('extra_backprop_test_concat_dynamic',
+         gen_concat_dynamic_backprop_test)
 
     test('extra_backprop_test_loop_012',
          gen_loop_backprop_test(0, 1, 2, 1, 5, 1))
@@ -1072,6 +1158,10 @@ def get_tests():
     test('extra_test_incomplete_transpose',
          gen_incomplete_transpose_test,
          skip_shape_inference=True)
+    test('extra_test_transpose_relu_transpose',
+         gen_transpose_relu_transpose_test)
+    test('extra_test_gemm_prepack', gen_gemm_prepack_test,
+         extra_args=['--prepack_weights'])
     test('extra_test_maxpool_cover_all', gen_maxpool_cover_all_test,
          skip_shape_inference=True)
 
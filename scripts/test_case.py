@@ -13,7 +13,8 @@ class TestCase(object):
                  skip_shape_inference=False,
                  want_gpu=False,
                  prepare_func=None,
-                 backend=None):
+                 backend=None,
+                 extra_args=None):
         assert name is not None
         self.name = name
         if basedir is None:
@@ -32,6 +33,7 @@ class TestCase(object):
         self.want_gpu = want_gpu
         self.prepare_func = prepare_func
         self.backend = backend
+        self.extra_args = extra_args or []
 
         self.log_dirname = self.test_dir
         if not self.log_dirname.startswith('out'):
@@ -11,12 +11,16 @@ void AddCompilerFlags(cmdline::parser* args) {
     args->add("skip_inference", '\0', "Skip dtype/shape inference");
     args->add<int>("recompute_relu", '\0', "Recompute Relu when the results are used by backprop after this number of steps", false, 0);
     args->add("replace_constant", '\0', "Replace Constant ops");
+    args->add("prepack_weights", '\0', "Transpose weights at compile time (weights must not be fed at runtime)");
     args->add("fuse_operations", '\0', "Fuse consecutive operations");
     args->add("use_nvrtc", '\0', "Use NVRTC");
     args->add("use_tvm", '\0', "Use TVM");
     args->add("reuse_tvm_code", '\0', "Reuse TVM code (unsafe)");
     args->add<std::string>("dump_autotvm_task_dir", '\0', "Output AutoTVM tasks in this directory", false);
     args->add<std::string>("autotvm_log", '\0', "A tuning log of AutoTVM which contains best scheduling parameters", false);
+    args->add<std::string>("optimizer", '\0', "Update parameters in the training graph (momentum_sgd or adam)", false);
+    args->add<float>("momentum", '\0', "Momentum of momentum_sgd", false, 0.9);
+    args->add<float>("weight_decay", '\0', "Weight decay rate of the in-graph optimizer", false, 0.0);
     args->add("dump_after_inference", '\0', "Dump the ONNX graph after dtype/shape inference");
     args->add("dump_after_simplification", '\0', "Dump the ONNX graph after graph simplification");
     args->add("dump_after_gradient", '\0', "Dump the ONNX graph after adding nodes for gradients");
@@ -30,6 +34,7 @@ void ApplyCompilerFlags(const cmdline::parser& args) {
     g_permissive = args.exist("permissive");
     g_skip_inference = args.exist("skip_inference");
     g_replace_constant = args.exist("replace_constant");
+    g_prepack_weights = args.exist("prepack_weights");
     g_fuse_operations = args.exist("fuse_operations");
     g_use_nvrtc = args.exist("use_nvrtc");
     g_use_tvm = args.exist("use_tvm");
@@ -37,6 +42,9 @@ void ApplyCompilerFlags(const cmdline::parser& args) {
     g_dump_autotvm_task_dir = args.get<std::string>("dump_autotvm_task_dir");
     g_autotvm_log = args.get<std::string>("autotvm_log");
     g_recompute_relu = args.get<int>("recompute_relu");
+    g_optimizer = args.get<std::string>("optimizer");
+    g_momentum = args.get<float>("momentum");
+    g_weight_decay = args.get<float>("weight_decay");
     g_dump_after_inference = args.exist("dump_after_inference");
     g_dump_after_simplification = args.exist("dump_after_simplification");
     g_dump_after_gradient = args.exist("dump_after_gradient");
@@ -0,0 +1,59 @@
+// Converts a labeled image list into a shard of pre-decoded examples
+// which can be read by RecordIterator.
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <common/log.h>
+#include <feeder/record_dataset.h>
+#include <tools/cmdline.h>
+
+namespace chainer_compiler {
+namespace runtime {
+namespace {
+
+void RunMain(int argc, char** argv) {
+    cmdline::parser args;
+    args.add<int>("height", '\0', "Height of stored images", false, 256);
+    args.add<int>("width", '\0', "Width of stored images", false, 256);
+    args.parse_check(argc, argv);
+
+    if (args.rest().size() != 2) {
+        QFAIL() << "Usage: " << argv[0] << " <train.txt> <output.rec>";
+    }
+    const int height = args.get<int>("height");
+    const int width = args.get<int>("width");
+
+    std::ifstream ifs(args.rest()[0]);
+    CHECK(ifs) << "Failed to open: " << args.rest()[0];
+    RecordShardWriter writer(args.rest()[1], height, width);
+    int num_records = 0;
+    std::string filename;
+    int label;
+    while (ifs >> filename >> label) {
+        cv::Mat image = cv::imread(filename);
+        CHECK(image.data) << "Failed to read: " << filename;
+        cv::Mat resized;
+        cv::resize(image, resized, cv::Size(width, height));
+        cv::Mat rgb;
+        cv::cvtColor(resized, rgb, cv::COLOR_BGR2RGB);
+        CHECK(rgb.isContinuous());
+        writer.Add(rgb.ptr<uint8_t>(), label);
+        if (++num_records % 1000 == 0) std::cerr << num_records << " images converted" << std::endl;
+    }
+    writer.Finish();
+    std::cerr << num_records << " images written to " << args.rest()[1] << std::endl;
+}
+
+}  // namespace
+}  // namespace runtime
+}  // namespace chainer_compiler
+
+int main(int argc, char** argv) {
+    chainer_compiler::runtime::RunMain(argc, argv);
+}
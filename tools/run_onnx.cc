@@ -1,11 +1,15 @@
 #include <dirent.h>
+#include <dlfcn.h>
 #include <sys/types.h>
 
 #include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <fstream>
 #include <map>
+#include <numeric>
 #include <queue>
 #include <set>
 #include <string>
@@ -20,6 +24,7 @@
 #include <chainerx/routines/creation.h>
 #include <chainerx/routines/manipulation.h>
 #include <chainerx/routines/math.h>
+#include <chainerx/routines/statistics.h>
 
 #include <common/log.h>
 #include <common/protoutil.h>
@@ -33,16 +38,20 @@
 #include <compiler/tensor.h>
 #include <compiler/util.h>
 #include <compiler/value.h>
+#include <compiler/xcvm/cpp_emitter.h>
 #include <compiler/xcvm/emitter.h>
 #include <runtime/chainerx_util.h>
 #include <runtime/chrome_tracing.h>
 #include <runtime/meminfo.h>
 #include <runtime/xcvm.h>
 #include <runtime/xcvm.pb.h>
+#include <runtime/xcvm_op.h>
+#include <runtime/xcvm_state.h>
 #include <runtime/xcvm_var.h>
 #include <tools/cmdline.h>
 #include <tools/compiler_flags.h>
 #include <tools/util.h>
+#include <tools/weight_store.h>
 
 namespace chainer_compiler {
 namespace runtime {
@@ -218,6 +227,45 @@ XCVMVar* StageVar(XCVMVar* var) {
     CHECK(false);
 }
 
+// Collects the ranges of floating point outputs of each instruction
+// over runs. The result can be used to calibrate quantization.
+class ValueRangeCollector {
+public:
+    void Collect(const XCVMOp& op, XCVMState* st) {
+        const XCInstructionProto& inst = op.instruction();
+        for (int i = 0; i < inst.outputs_size(); ++i) {
+            int id = inst.outputs(i);
+            if (id < 0) continue;
+            XCVMVar* var = st->GetVar(id);
+            if (var->kind() != XCVMVar::Kind::kArray) continue;
+            const chainerx::Array& a = var->GetArray();
+            if (a.dtype() != chainerx::Dtype::kFloat32 && a.dtype() != chainerx::Dtype::kFloat64) continue;
+            if (a.GetTotalSize() == 0) continue;
+            double max = static_cast<double>(chainerx::AsScalar(chainerx::AMax(a)));
+            double min = -static_cast<double>(chainerx::AsScalar(chainerx::AMax(-a)));
+
+            auto p = ranges_.emplace(std::make_pair(&op, i), std::make_pair(min, max));
+            if (p.second) {
+                order_.emplace_back(&op, i);
+            } else {
+                p.first->second.first = std::min(p.first->second.first, min);
+                p.first->second.second = std::max(p.first->second.second, max);
+            }
+        }
+    }
+
+    void Dump(std::ostream& os) const {
+        for (const auto& key : order_) {
+            const auto& range = ranges_.find(key)->second;
+            os << key.first->debug_info() << " #" << key.second << ": [" << range.first << ", " << range.second << "]\n";
+        }
+    }
+
+private:
+    std::map<std::pair<const XCVMOp*, int>, std::pair<double, double>> ranges_;
+    std::vector<std::pair<const XCVMOp*, int>> order_;
+};
+
 class ModelRunner {
 public:
     ModelRunner(const cmdline::parser& args, int64_t initial_free_bytes, Model* model)
@@ -257,8 +305,36 @@ public:
         if (!args_.get<std::string>("chrome_tracing").empty()) {
             xcvm_opts_.chrome_tracing = new ChromeTracingEmitter();
         }
+        if (args_.exist("calibrate")) {
+            xcvm_opts_.after_op_hook = [this](const XCVMOp& op, XCVMState* st) { value_ranges_.Collect(op, st); };
+        }
+
+        const std::string aot_library = args_.get<std::string>("aot_library");
+        if (!aot_library.empty()) {
+            CHECK(!xcvm_bp_) << "--aot_library does not support --backprop_two_phase";
+            void* handle = dlopen(aot_library.c_str(), RTLD_NOW);
+            CHECK(handle) << "Failed to load " << aot_library << ": " << dlerror();
+            aot_entry_ = reinterpret_cast<AOTEntryPoint>(dlsym(handle, kAOTEntryPointName));
+            CHECK(aot_entry_) << "No entry point in " << aot_library;
+        }
 
-        params_ = LoadParams(model->graph());
+        const std::string weight_store_dir = args_.get<std::string>("weight_store");
+        std::chrono::steady_clock::time_point load_start = std::chrono::steady_clock::now();
+        if (weight_store_dir.empty()) {
+            params_ = LoadParams(model->graph());
+        } else {
+            WeightStore weight_store(weight_store_dir);
+            params_ = LoadParams(model->graph(), &weight_store);
+            LOG() << "Shared " << weight_store.num_shared_bytes() / 1000 / 1000 << "MB of weights via " << weight_store_dir << std::endl;
+        }
+        // `params_` owns or maps the weights now, so drop the copies in
+        // the graph which would otherwise stay alive with `model`.
+        for (Value* input : model->graph().input_values()) {
+            if (input->initializer()) input->ResetInitializer(nullptr);
+        }
+        std::chrono::steady_clock::time_point load_end = std::chrono::steady_clock::now();
+        LOG() << "Loaded params in " << std::chrono::duration_cast<std::chrono::microseconds>(load_end - load_start).count() * 0.001
+              << " msec, RSS=" << GetResidentBytes() / 1000 / 1000 << "MB" << std::endl;
         param_bytes_ = initial_free_bytes - GetMemoryUsageInBytes();
     }
 
@@ -300,6 +376,23 @@ public:
             CHECK(xcvm_prog.SerializeToOstream(&ofs));
         }
 
+        std::string out_cpp = args_.get<std::string>("out_cpp");
+        if (!out_cpp.empty()) {
+            if (name) {
+                out_cpp = StrCat(out_cpp, '_', name);
+            }
+            const std::string basename = out_cpp.substr(out_cpp.rfind('/') + 1);
+            std::string func_name = basename;
+            for (char& c : func_name) {
+                if (!std::isalnum(c)) c = '_';
+            }
+            std::ofstream header(out_cpp + ".h");
+            CHECK(header) << "Failed to open output header: " << out_cpp << ".h";
+            std::ofstream source(out_cpp + ".cc");
+            CHECK(source) << "Failed to open output source: " << out_cpp << ".cc";
+            xcvm::EmitCpp(xcvm_prog, func_name, basename + ".h", header, source);
+        }
+
         xcvm->reset(new XCVM(xcvm_prog));
     }
 
@@ -307,11 +400,20 @@ public:
         if (xcvm_opts_.chrome_tracing) {
             xcvm_opts_.chrome_tracing->Emit(args_.get<std::string>("chrome_tracing"));
         }
+        if (args_.exist("calibrate")) {
+            std::cerr << "=== Value ranges ===\n";
+            value_ranges_.Dump(std::cerr);
+        }
     }
 
     InOuts Run(const InOuts& inputs) {
         if (trace_level()) std::cerr << "Running XCVM..." << std::endl;
-        InOuts outputs = xcvm_->Run(inputs, xcvm_opts_);
+        InOuts outputs;
+        if (aot_entry_) {
+            aot_entry_(inputs, xcvm_opts_, &outputs);
+        } else {
+            outputs = xcvm_->Run(inputs, xcvm_opts_);
+        }
         MaybeShowGPUMemory();
         if (xcvm_bp_.get()) {
             if (trace_level()) std::cerr << "Running XCVM for backward..." << std::endl;
@@ -366,6 +468,9 @@ private:
     Model* model_;
     const cmdline::parser& args_;
     std::unique_ptr<XCVM> xcvm_;
+    // The program compiled ahead of time, which is used instead of
+    // `xcvm_` if specified.
+    AOTEntryPoint aot_entry_{nullptr};
     XCVMOptions xcvm_opts_;
     InOuts params_;
     const int64_t initial_free_bytes_;
@@ -373,8 +478,80 @@ private:
 
     std::unique_ptr<XCVM> xcvm_bp_;
     std::vector<std::string> backprop_ins_;
+
+    ValueRangeCollector value_ranges_;
 };
 
+InOuts StageInputs(const InOuts& params, const TestCase& test_case) {
+    InOuts inputs(params);
+    for (const auto& p : test_case.inputs) {
+        XCVMVar* v = StageVar(p.second.get());
+        CHECK(inputs.emplace(p.first, std::shared_ptr<XCVMVar>(v)).second) << "Duplicated input parameter: " << p.first;
+    }
+    return inputs;
+}
+
+// Runs the model without verification and reports the distribution
+// of latencies. Inputs are staged once and shared by all runs.
+void RunBenchmark(const cmdline::parser& args, ModelRunner* model_runner, const std::vector<std::unique_ptr<TestCase>>& test_cases) {
+    const int num_warmups = args.get<int>("warmup");
+    const int num_runs = args.get<int>("benchmark");
+    CHECK_LE(0, num_warmups);
+
+    std::vector<InOuts> staged_inputs;
+    for (const std::unique_ptr<TestCase>& test_case : test_cases) {
+        staged_inputs.push_back(StageInputs(model_runner->params(), *test_case));
+    }
+
+    for (int i = 0; i < num_warmups; ++i) {
+        model_runner->Run(staged_inputs[i % staged_inputs.size()]);
+    }
+    chainerx::GetDefaultDevice().Synchronize();
+
+    std::vector<double> latencies;
+    for (int i = 0; i < num_runs; ++i) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        {
+            InOuts outputs(model_runner->Run(staged_inputs[i % staged_inputs.size()]));
+            chainerx::GetDefaultDevice().Synchronize();
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6);
+        }
+    }
+
+    const double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    std::sort(latencies.begin(), latencies.end());
+    // Nearest-rank percentiles.
+    auto percentile = [&latencies](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100 * latencies.size()));
+        return latencies[std::max<size_t>(rank, 1) - 1];
+    };
+    const std::vector<std::pair<std::string, double>> stats = {
+            {"min", latencies.front()},
+            {"p50", percentile(50)},
+            {"p90", percentile(90)},
+            {"p99", percentile(99)},
+            {"max", latencies.back()},
+            {"mean", total / num_runs},
+    };
+    const double throughput = num_runs / (total * 1e-3);
+
+    std::cerr << "Benchmark: warmup=" << num_warmups << " runs=" << num_runs << std::endl;
+    for (const auto& p : stats) std::cerr << "  " << p.first << ": " << p.second << " msec" << std::endl;
+    std::cerr << "  throughput: " << throughput << " runs/sec" << std::endl;
+
+    const std::string json_path = args.get<std::string>("benchmark_json");
+    if (!json_path.empty()) {
+        std::ofstream ofs(json_path);
+        CHECK(ofs) << "Failed to open: " << json_path;
+        ofs << "{\"warmup\": " << num_warmups << ", \"runs\": " << num_runs << ", \"latency_msec\": {";
+        for (size_t i = 0; i < stats.size(); ++i) {
+            ofs << (i ? ", " : "") << '"' << stats[i].first << "\": " << stats[i].second;
+        }
+        ofs << "}, \"throughput_per_sec\": " << throughput << "}\n";
+    }
+}
+
 void RunMain(const std::vector<std::string>& argv) {
     g_modify_pool_with_imbalanced_pads = true;
 
@@ -386,10 +563,17 @@ void RunMain(const std::vector<std::string>& argv) {
     args.add<std::string>("device", 'd', "ChainerX device to be used", false);
     args.add<std::string>("out_onnx", '\0', "Output ONNX model after optimization", false);
     args.add<std::string>("out_xcvm", '\0', "Output XCVM program", false);
+    args.add<std::string>("out_cpp", '\0', "Output the XCVM program as C++ sources with this prefix", false);
+    args.add<std::string>("aot_library", '\0', "Run the program in a shared library built from --out_cpp", false);
+    args.add<std::string>("weight_store", '\0', "Share weights with other processes through this directory", false);
     args.add<int>("iterations", 'I', "The number of iteartions", false, 1);
+    args.add<int>("benchmark", '\0', "Run this number of timed iterations without verification", false, 0);
+    args.add<int>("warmup", '\0', "The number of untimed iterations before --benchmark", false, 1);
+    args.add<std::string>("benchmark_json", '\0', "Output the result of --benchmark as JSON", false);
     args.add<double>("rtol", '\0', "rtol of AllClose", false, 1e-4);
     args.add("check_nans", '\0', "Check for NaNs after each operation");
     args.add("check_infs", '\0', "Check for infinities after each operation");
+    args.add("calibrate", '\0', "Collect and dump ranges of values computed by each operation");
     args.add("compile_only", '\0', "Exit after compilation");
     args.add("dump_onnx", '\0', "Dump ONNX model after optimization");
     args.add("dump_xcvm", '\0', "Dump XCVM program");
@@ -437,7 +621,10 @@ void RunMain(const std::vector<std::string>& argv) {
     LOG() << "Loading model..." << std::endl;
     RegisterCustomOnnxOperatorSetSchema();
     onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(onnx_path));
+    ResolveExternalDataLocations(onnx_path, &xmodel);
     Model model(xmodel);
+    // `model` has its own copies of the weights.
+    xmodel.mutable_graph()->clear_initializer();
     if (!g_skip_inference) model.mutable_graph()->InferShapes();
 
     LOG() << "Loading data..." << std::endl;
@@ -481,15 +668,16 @@ void RunMain(const std::vector<std::string>& argv) {
 
     if (args.exist("compile_only")) return;
 
+    if (args.get<int>("benchmark") > 0) {
+        RunBenchmark(args, &model_runner, test_cases);
+        return;
+    }
+
     double elapsed_total = 0;
     int test_cnt = 0;
     for (const std::unique_ptr<TestCase>& test_case : test_cases) {
         LOG() << "Running for " << test_case->name << std::endl;
-        InOuts inputs(model_runner.params());
-        for (const auto& p : test_case->inputs) {
-            XCVMVar* v = StageVar(p.second.get());
-            CHECK(inputs.emplace(p.first, std::shared_ptr<XCVMVar>(v)).second) << "Duplicated input parameter: " << p.first;
-        }
+        InOuts inputs(StageInputs(model_runner.params(), *test_case));
 
         std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
         InOuts outputs(model_runner.Run(inputs));
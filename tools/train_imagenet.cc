@@ -1,15 +1,22 @@
 #include "tools/train_imagenet.h"
 
+#include <algorithm>
 #include <chrono>
+#include <memory>
 #include <set>
+#include <thread>
 
 #include <compiler/onnx.h>
 
 #include <chainerx/array.h>
 #include <chainerx/backprop_mode.h>
 #include <chainerx/context.h>
+#include <chainerx/dtype.h>
+#include <chainerx/native/native_device.h>
 #include <chainerx/routines/creation.h>
 #include <chainerx/routines/manipulation.h>
+#include <chainerx/routines/math.h>
+#include <chainerx/slice.h>
 
 #include <common/log.h>
 #include <common/protoutil.h>
@@ -24,6 +31,7 @@
 #include <compiler/value.h>
 #include <compiler/xcvm/emitter.h>
 #include <feeder/imagenet_iterator.h>
+#include <feeder/record_dataset.h>
 #include <runtime/chainerx_util.h>
 #include <runtime/chrome_tracing.h>
 #include <runtime/meminfo.h>
@@ -50,12 +58,97 @@ bool ExpectsOnehot(const Model& model) {
     return (input_names.count("Input_0") && input_names.count("Input_1") && input_names.count("Input_2"));
 }
 
+bool IsAllFinite(const chainerx::Array& a) {
+    if (static_cast<int>(chainerx::AsScalar(chainerx::Sum(chainerx::IsNan(a))))) return false;
+    if (static_cast<int>(chainerx::AsScalar(chainerx::Sum(chainerx::IsInf(a))))) return false;
+    return true;
+}
+
+// Averages gradients of all replicas into the arrays of the first
+// replica. `grads[r][i]` is the i-th gradient of the r-th replica.
+//
+// Gradients are packed into buckets of about `bucket_bytes` and the
+// i-th thread reduces every N-th bucket from i. This is the
+// reduce-scatter half of a ring allreduce over shared memory. The
+// all-gather half is unnecessary as replicas share parameters.
+void AllreduceGradients(const std::vector<std::vector<chainerx::Array>>& grads, int64_t bucket_bytes) {
+    const int num_replicas = grads.size();
+    const float scale = 1.0f / num_replicas;
+    bool on_host = true;
+    for (const std::vector<chainerx::Array>& arrays : grads) {
+        for (const chainerx::Array& a : arrays) {
+            if (a.dtype() != chainerx::Dtype::kFloat32 || !a.IsContiguous() ||
+                !dynamic_cast<const chainerx::native::NativeDevice*>(&a.device())) {
+                on_host = false;
+            }
+        }
+    }
+    if (!on_host) {
+        for (size_t i = 0; i < grads[0].size(); ++i) {
+            chainerx::Array sum = grads[0][i];
+            for (int r = 1; r < num_replicas; ++r) sum += grads[r][i];
+            sum *= scale;
+        }
+        return;
+    }
+
+    // A range of elements in the `index`-th gradient.
+    struct Segment {
+        size_t index;
+        int64_t begin;
+        int64_t end;
+    };
+    const int64_t bucket_size = std::max<int64_t>(1, bucket_bytes / sizeof(float));
+    std::vector<std::vector<Segment>> buckets(1);
+    int64_t filled = 0;
+    for (size_t i = 0; i < grads[0].size(); ++i) {
+        const int64_t size = grads[0][i].GetTotalSize();
+        for (int64_t begin = 0; begin < size;) {
+            if (filled == bucket_size) {
+                buckets.emplace_back();
+                filled = 0;
+            }
+            const int64_t end = std::min(size, begin + bucket_size - filled);
+            buckets.back().push_back(Segment{i, begin, end});
+            filled += end - begin;
+            begin = end;
+        }
+    }
+
+    auto reduce = [&grads, &buckets, num_replicas, scale](int worker) {
+        for (size_t b = worker; b < buckets.size(); b += num_replicas) {
+            for (const Segment& seg : buckets[b]) {
+                float* dst = static_cast<float*>(RawStartPtr(grads[0][seg.index]));
+                for (int r = 1; r < num_replicas; ++r) {
+                    const float* src = static_cast<const float*>(RawStartPtr(grads[r][seg.index]));
+                    for (int64_t j = seg.begin; j < seg.end; ++j) dst[j] += src[j];
+                }
+                for (int64_t j = seg.begin; j < seg.end; ++j) dst[j] *= scale;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int r = 1; r < num_replicas; ++r) threads.emplace_back(reduce, r);
+    reduce(0);
+    for (std::thread& th : threads) th.join();
+}
+
 void RunMain(const std::vector<std::string>& argv) {
     g_modify_pool_with_imbalanced_pads = true;
 
     cmdline::parser args;
     args.add<int>("batchsize", 'B', "Batch size", false, 32);
+    args.add<int>("num_decode_workers", '\0', "Number of threads which decode images of a batch", false, 1);
+    args.add<int>("prefetch_depth", '\0', "Number of batches prepared ahead", false, 3);
+    args.add<int>("epochs", '\0', "Number of passes over record shards, reshuffled each time", false, 1);
+    args.add<int>("num_replicas", '\0', "Number of threads which run the model on shards of a batch", false, 1);
+    args.add<int>("num_micro_batches", '\0', "Split a batch into micro-batches and accumulate their gradients", false, 1);
+    args.add<float>("allreduce_bucket_mb", '\0', "Size of buckets in which gradients of replicas are reduced", false, 4);
+    args.add<double>("baseline_throughput", '\0', "Images/sec of one replica to report the scaling efficiency", false, 0);
     args.add<float>("learning_rate", '\0', "Learning rate", false, 0.01);
+    args.add<float>("loss_scale", '\0', "Scale the loss by this value before backprop", false, 1.0);
+    args.add("dynamic_loss_scale", '\0', "Adjust the loss scale and skip updates when gradients overflow");
+    args.add<int>("loss_scale_growth_interval", '\0', "Double the dynamic loss scale after this number of good steps", false, 2000);
     args.add<std::string>("device", 'd', "ChainerX device to be used", false);
     args.add<std::string>("chrome_tracing", '\0', "Output chrome tracing profile", false);
     args.add<int>("chrome_tracing_frequency", '\0', "Output chrome tracing every this itearation", false, 100);
@@ -79,6 +172,11 @@ void RunMain(const std::vector<std::string>& argv) {
 
     g_quiet = args.exist("quiet");
     int batch_size = args.get<int>("batchsize");
+    const int num_micro_batches = args.get<int>("num_micro_batches");
+    CHECK_LT(0, num_micro_batches);
+    // Micro-batches add their gradients to grad_accum@ inputs in the
+    // program, so only activations of one micro-batch are alive.
+    if (num_micro_batches > 1) g_accumulate_grads = true;
 
     LOG() << "Initializing ChainerX..." << std::endl;
     chainerx::Context ctx;
@@ -98,6 +196,7 @@ void RunMain(const std::vector<std::string>& argv) {
     LOG() << "Constructing model..." << std::endl;
     RegisterCustomOnnxOperatorSetSchema();
     onnx::ModelProto xmodel(LoadLargeProto<onnx::ModelProto>(args.rest()[0]));
+    ResolveExternalDataLocations(args.rest()[0], &xmodel);
     Model model(xmodel);
     if (!g_skip_inference) model.mutable_graph()->InferShapes();
     const bool expects_onehot = ExpectsOnehot(model);
@@ -116,7 +215,25 @@ void RunMain(const std::vector<std::string>& argv) {
 
     InOuts params(LoadParams(model.graph()));
 
-    chainerx::Array batch_size_array = MakeScalarArray(static_cast<float>(batch_size)).ToDevice(chainerx::GetDefaultDevice());
+    // The initial gradient of the loss is an input with an
+    // initializer, so we can feed the loss scale through it.
+    const std::string loss_scale_name = "grad_in_one@" + loss_value_name;
+    CHECK(params.count(loss_scale_name)) << "No initial gradient for the loss: " << loss_scale_name;
+    float loss_scale = args.get<float>("loss_scale");
+    CHECK_LT(0, loss_scale);
+    const bool dynamic_loss_scale = args.exist("dynamic_loss_scale");
+    const int loss_scale_growth_interval = args.get<int>("loss_scale_growth_interval");
+    int num_good_steps = 0;
+
+    // In-graph optimizers update parameters inside the program, so
+    // outputs have no gradients to update on the host.
+    if (!g_optimizer.empty()) {
+        CHECK(!dynamic_loss_scale) << "--dynamic_loss_scale cannot skip updates of --optimizer";
+        chainerx::Array lr = MakeScalarArray(args.get<float>("learning_rate")).ToDevice(chainerx::GetDefaultDevice());
+        params["optimizer@lr"] = std::shared_ptr<XCVMVar>(new XCVMVar(lr));
+        chainerx::Array grad_scale = MakeScalarArray(1 / loss_scale).ToDevice(chainerx::GetDefaultDevice());
+        params["optimizer@grad_scale"] = std::shared_ptr<XCVMVar>(new XCVMVar(grad_scale));
+    }
 
     int trace_level = args.exist("verbose") ? 2 : args.exist("trace") ? 1 : 0;
 
@@ -139,7 +256,44 @@ void RunMain(const std::vector<std::string>& argv) {
         }
     }
 
-    XCVM xcvm(xcvm_prog);
+    const int num_replicas = args.get<int>("num_replicas");
+    CHECK_LT(0, num_replicas);
+    CHECK(num_replicas == 1 || g_optimizer.empty()) << "--num_replicas does not work with --optimizer";
+    std::vector<std::unique_ptr<XCVM>> xcvms;
+    for (int i = 0; i < num_replicas; ++i) xcvms.emplace_back(new XCVM(xcvm_prog));
+
+    // Replicas share parameters which have gradients. Other inputs
+    // with initializers (e.g., running statistics of batch
+    // normalization and gradient accumulators) are updated in place,
+    // so each replica has its own.
+    std::set<std::string> grad_params;
+    for (const Value* value : model.graph().output_values()) {
+        if (HasPrefix(value->name(), "grad_out@")) grad_params.insert(value->name().substr(9));
+    }
+    for (const Value* value : model.graph().input_values()) {
+        if (HasPrefix(value->name(), "grad_accum@")) grad_params.insert(value->name().substr(11));
+    }
+    std::vector<InOuts> replica_params(num_replicas, params);
+    for (int i = 1; i < num_replicas; ++i) {
+        for (auto& p : replica_params[i]) {
+            if (grad_params.count(p.first) || p.second->kind() != XCVMVar::Kind::kArray) continue;
+            p.second.reset(new XCVMVar(p.second->GetArray().Copy()));
+        }
+    }
+    // Running statistics of batch normalization are updated by each
+    // replica from its own shard. They are averaged after every step
+    // so evaluation does not depend on which replica is used.
+    std::vector<std::string> replica_stats;
+    if (num_replicas > 1) {
+        for (const auto& p : params) {
+            if (grad_params.count(p.first) || p.second->kind() != XCVMVar::Kind::kArray) continue;
+            if (HasPrefix(p.first, "grad_accum@") || p.first == loss_scale_name) continue;
+            if (chainerx::GetKind(p.second->GetArray().dtype()) != chainerx::DtypeKind::kFloat) continue;
+            replica_stats.push_back(p.first);
+        }
+    }
+    const int64_t bucket_bytes = static_cast<int64_t>(args.get<float>("allreduce_bucket_mb") * 1000 * 1000);
+
     XCVMOptions xcvm_opts;
     xcvm_opts.trace_level = trace_level;
     xcvm_opts.is_training = true;
@@ -159,76 +313,182 @@ void RunMain(const std::vector<std::string>& argv) {
         }
     }
     const std::vector<float>& mean = LoadMean(args.rest()[2], height, width);
-    ImageNetIterator train_iter(args.rest()[1], 3, batch_size, mean, height, width);
-    train_iter.Start();
+    const int prefetch_depth = args.get<int>("prefetch_depth");
+    std::unique_ptr<DataIterator> train_iter;
+    if (HasSuffix(args.rest()[1], ".rec")) {
+        train_iter.reset(new RecordIterator(
+                SplitString(args.rest()[1], ","), prefetch_depth, batch_size, mean, height, width, args.get<int>("epochs")));
+    } else {
+        train_iter.reset(new ImageNetIterator(
+                args.rest()[1], prefetch_depth, batch_size, mean, height, width, args.get<int>("num_decode_workers")));
+    }
+    train_iter->Start();
 
     std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
     LOG() << "Start training!" << std::endl;
     int iter_count = 0;
     int max_iterations = args.get<int>("iterations");
+    int64_t total_examples = 0;
+    double total_elapsed = 0;
     for (; !max_iterations || iter_count < max_iterations; ++iter_count) {
         if (!args.get<std::string>("chrome_tracing").empty() && iter_count % args.get<int>("chrome_tracing_frequency") == 1) {
             xcvm_opts.chrome_tracing = new ChromeTracingEmitter();
         }
 
-        InOuts inputs;
+        // The i-th micro-batch of the r-th replica is at [r * num_micro_batches + i].
+        const int num_shards = num_replicas * num_micro_batches;
+        std::vector<InOuts> inputs(num_shards);
+        int64_t num_examples = 0;
         {
             ChromeTracingEmitter::ScopedEvent se(xcvm_opts.chrome_tracing, "Trainer", "Prepare");
 
-            std::vector<chainerx::Array> data = train_iter.GetNext();
+            std::vector<chainerx::Array> data = train_iter->GetNext();
             if (data.empty()) break;
-
-            inputs = params;
-            if (expects_onehot) {
-                CHECK_EQ(2, data.size());
-                CHECK_EQ(3, infeed_values.size());
-                inputs.emplace("Input_0", std::shared_ptr<XCVMVar>(new XCVMVar(data[0].ToDevice(chainerx::GetDefaultDevice()))));
-                chainerx::Array labels = data[1].ToDevice(chainerx::GetDefaultDevice()).AsType(chainerx::Dtype::kInt64);
-                chainerx::Array onehot = chainerx::Eye(1000, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32).Take(labels, 0);
-                inputs.emplace("Input_1", std::shared_ptr<XCVMVar>(new XCVMVar(onehot)));
-                inputs.emplace("Input_2", std::shared_ptr<XCVMVar>(new XCVMVar(batch_size_array)));
-            } else {
-                CHECK_EQ(2, data.size());
-                CHECK_EQ(2, infeed_values.size());
-                inputs.emplace(
-                        infeed_values[0]->name(), std::shared_ptr<XCVMVar>(new XCVMVar(data[0].ToDevice(chainerx::GetDefaultDevice()))));
-                chainerx::Array labels = data[1].ToDevice(chainerx::GetDefaultDevice()).AsType(chainerx::Dtype::kInt64);
-                inputs.emplace(infeed_values[1]->name(), std::shared_ptr<XCVMVar>(new XCVMVar(labels)));
+            CHECK_EQ(2, data.size());
+            // Examples which cannot be split evenly are dropped.
+            const int64_t shard_size = data[0].shape()[0] / num_shards;
+            if (shard_size == 0) break;
+            num_examples = shard_size * num_shards;
+
+            for (int i = 0; i < num_shards; ++i) {
+                auto shard = [num_shards, shard_size, i](const chainerx::Array& a) {
+                    if (num_shards == 1) return a.ToDevice(chainerx::GetDefaultDevice());
+                    return a.At({chainerx::Slice(i * shard_size, (i + 1) * shard_size)}).Copy().ToDevice(chainerx::GetDefaultDevice());
+                };
+
+                inputs[i] = replica_params[i / num_micro_batches];
+                if (expects_onehot) {
+                    CHECK_EQ(3, infeed_values.size());
+                    inputs[i].emplace("Input_0", std::shared_ptr<XCVMVar>(new XCVMVar(shard(data[0]))));
+                    chainerx::Array labels = shard(data[1]).AsType(chainerx::Dtype::kInt64);
+                    chainerx::Array onehot = chainerx::Eye(1000, nonstd::nullopt, nonstd::nullopt, chainerx::Dtype::kFloat32).Take(labels, 0);
+                    inputs[i].emplace("Input_1", std::shared_ptr<XCVMVar>(new XCVMVar(onehot)));
+                    chainerx::Array batch_size_array = MakeScalarArray(static_cast<float>(shard_size)).ToDevice(chainerx::GetDefaultDevice());
+                    inputs[i].emplace("Input_2", std::shared_ptr<XCVMVar>(new XCVMVar(batch_size_array)));
+                } else {
+                    CHECK_EQ(2, infeed_values.size());
+                    inputs[i].emplace(infeed_values[0]->name(), std::shared_ptr<XCVMVar>(new XCVMVar(shard(data[0]))));
+                    chainerx::Array labels = shard(data[1]).AsType(chainerx::Dtype::kInt64);
+                    inputs[i].emplace(infeed_values[1]->name(), std::shared_ptr<XCVMVar>(new XCVMVar(labels)));
+                }
+
+                if (loss_scale != 1.0) {
+                    chainerx::Array scale = MakeScalarArray(loss_scale).ToDevice(chainerx::GetDefaultDevice());
+                    inputs[i][loss_scale_name] = std::shared_ptr<XCVMVar>(new XCVMVar(scale));
+                }
             }
         }
 
-        InOuts outputs;
-
+        std::vector<InOuts> outputs(num_shards);
         {
             ChromeTracingEmitter::ScopedEvent se(xcvm_opts.chrome_tracing, "Trainer", "Run");
-            outputs = xcvm.Run(inputs, xcvm_opts);
+            if (num_replicas == 1) {
+                for (int i = 0; i < num_micro_batches; ++i) outputs[i] = xcvms[0]->Run(inputs[i], xcvm_opts);
+            } else {
+                chainerx::Device* device = &chainerx::GetDefaultDevice();
+                std::vector<std::thread> threads;
+                for (int r = 0; r < num_replicas; ++r) {
+                    threads.emplace_back([&xcvms, &inputs, &outputs, &xcvm_opts, device, num_micro_batches, r]() {
+                        chainerx::SetDefaultDevice(device);
+                        chainerx::NoBackpropModeScope no_backprop;
+                        XCVMOptions opts = xcvm_opts;
+                        if (r) opts.chrome_tracing = nullptr;
+                        for (int i = r * num_micro_batches; i < (r + 1) * num_micro_batches; ++i) {
+                            outputs[i] = xcvms[r]->Run(inputs[i], opts);
+                        }
+                    });
+                }
+                for (std::thread& th : threads) th.join();
+            }
         }
 
         {
             ChromeTracingEmitter::ScopedEvent se(xcvm_opts.chrome_tracing, "Trainer", "Update");
-            for (auto&& p : outputs) {
-                if (!HasPrefix(p.first, "grad_out@")) continue;
-                const std::string& param_name = p.first.substr(9);
-                auto found = inputs.find(param_name);
-                CHECK(found != inputs.end());
+            std::vector<XCVMVar*> params_to_update;
+            std::vector<std::vector<chainerx::Array>> grads(num_replicas);
+            for (const std::string& param_name : grad_params) {
+                auto found = inputs[0].find(param_name);
+                CHECK(found != inputs[0].end());
                 XCVMVar* param = found->second.get();
-                XCVMVar* grad = p.second.get();
                 CHECK_EQ(param->kind(), XCVMVar::Kind::kArray) << "Only an array can be a parameter";
-                CHECK_EQ(grad->kind(), XCVMVar::Kind::kArray) << "Only an array can be a parameter";
-                param->GetArray() -= grad->GetArray() * args.get<float>("learning_rate");
+                params_to_update.push_back(param);
+                for (int r = 0; r < num_replicas; ++r) {
+                    XCVMVar* grad = g_accumulate_grads ? replica_params[r].at("grad_accum@" + param_name).get()
+                                                       : outputs[r * num_micro_batches].at("grad_out@" + param_name).get();
+                    CHECK_EQ(grad->kind(), XCVMVar::Kind::kArray) << "Only an array can be a parameter";
+                    grads[r].push_back(grad->GetArray());
+                }
+            }
+
+            if (num_replicas > 1) AllreduceGradients(grads, bucket_bytes);
+
+            bool is_finite = true;
+            if (dynamic_loss_scale) {
+                for (const chainerx::Array& grad : grads[0]) {
+                    if (!IsAllFinite(grad)) {
+                        is_finite = false;
+                        break;
+                    }
+                }
+            }
+
+            if (is_finite) {
+                // Parameters are kept in fp32 and gradients are unscaled
+                // and averaged over micro-batches here.
+                float lr = args.get<float>("learning_rate") / (loss_scale * num_micro_batches);
+                for (size_t i = 0; i < params_to_update.size(); ++i) {
+                    params_to_update[i]->GetArray() -= grads[0][i] * lr;
+                }
+            }
+
+            for (const std::string& name : replica_stats) {
+                chainerx::Array sum = replica_params[0].at(name)->GetArray().Copy();
+                for (int r = 1; r < num_replicas; ++r) sum += replica_params[r].at(name)->GetArray();
+                chainerx::Array mean = sum * (1.0f / num_replicas);
+                for (int r = 0; r < num_replicas; ++r) {
+                    const chainerx::Array& stat = replica_params[r].at(name)->GetArray();
+                    stat.Fill(0);
+                    stat += mean;
+                }
+            }
+
+            if (g_accumulate_grads) {
+                for (const std::vector<chainerx::Array>& arrays : grads) {
+                    for (const chainerx::Array& a : arrays) a.Fill(0);
+                }
+            }
+
+            if (dynamic_loss_scale) {
+                if (!is_finite) {
+                    loss_scale = std::max(loss_scale / 2, 1.0f);
+                    num_good_steps = 0;
+                    LOG() << "Gradient overflow, skipping update. loss_scale=" << loss_scale << std::endl;
+                } else if (++num_good_steps == loss_scale_growth_interval) {
+                    loss_scale *= 2;
+                    num_good_steps = 0;
+                }
             }
         }
 
-        double loss;
+        double loss = 0;
         {
             ChromeTracingEmitter::ScopedEvent se(xcvm_opts.chrome_tracing, "Trainer", "Sync");
-            loss = static_cast<double>(chainerx::AsScalar(outputs[loss_value_name]->GetArray()));
+            for (InOuts& o : outputs) {
+                loss += static_cast<double>(chainerx::AsScalar(o[loss_value_name]->GetArray()));
+            }
+            loss /= num_shards;
         }
 
         std::chrono::system_clock::time_point end = std::chrono::system_clock::now();
         double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() * 0.001;
         start = end;
-        std::cout << train_iter.GetStatus() << " loss=" << loss << " elapsed=" << elapsed << "ms";
+        // The first iteration is excluded as a warmup.
+        if (iter_count) {
+            total_examples += num_examples;
+            total_elapsed += elapsed;
+        }
+        std::cout << train_iter->GetStatus() << " loss=" << loss << " elapsed=" << elapsed << "ms";
+        std::cout << " images/sec=" << num_examples / elapsed * 1000;
         if (initial_free_bytes >= 0) {
             int64_t free_bytes = GetMemoryUsageInBytes();
             size_t used_bytes = initial_free_bytes - free_bytes;
@@ -245,7 +505,16 @@ void RunMain(const std::vector<std::string>& argv) {
         }
     }
 
-    train_iter.Terminate();
+    if (total_elapsed > 0) {
+        const double throughput = total_examples / total_elapsed * 1000;
+        std::cout << "Average throughput with " << num_replicas << " replicas and " << num_micro_batches
+                  << " micro-batches: " << throughput << " images/sec";
+        const double baseline = args.get<double>("baseline_throughput");
+        if (baseline > 0) std::cout << " scaling efficiency=" << throughput / (baseline * num_replicas);
+        std::cout << std::endl;
+    }
+
+    train_iter->Terminate();
 }
 
 }  // namespace
@@ -2,10 +2,15 @@
 
 #include <algorithm>
 
+#include <chainerx/native/native_backend.h>
+#include <chainerx/native/native_device.h>
+#include <chainerx/routines/creation.h>
+
 #include <compiler/graph.h>
 #include <compiler/model.h>
 #include <runtime/chainerx_util.h>
 #include <runtime/xcvm_var.h>
+#include <tools/weight_store.h>
 
 namespace chainer_compiler {
 namespace runtime {
@@ -33,7 +38,7 @@ chainerx::Dtype ChainerXTypeFromONNX(int xtype) {
     }
 }
 
-InOuts LoadParams(const Graph& graph) {
+InOuts LoadParams(const Graph& graph, WeightStore* weight_store) {
     InOuts params;
     for (const Value* input : graph.input_values()) {
         if (input->users().empty()) continue;
@@ -46,9 +51,24 @@ InOuts LoadParams(const Graph& graph) {
             // it on host memory.
             // TODO(hamaji): Introduce more sophisticated approach to
             // decide the device to be used.
-            if (std::find_if(input->users().begin(), input->users().end(), [input](const Node* node) {
-                    return node->op_type() != Node::kReshape || node->input(1) != input;
-                }) == input->users().end()) {
+            const bool on_host = std::find_if(input->users().begin(), input->users().end(), [input](const Node* node) {
+                                     return node->op_type() != Node::kReshape || node->input(1) != input;
+                                 }) == input->users().end();
+            chainerx::Device& device = on_host ? chainerx::GetNativeBackend().GetDevice(0) : chainerx::GetDefaultDevice();
+            const bool is_native = dynamic_cast<chainerx::native::NativeDevice*>(&device);
+            std::shared_ptr<void> shared_data;
+            if (is_native) {
+                shared_data = initializer->GetSharedData();
+                const size_t num_bytes = initializer->NumElements() * initializer->ElementSize();
+                // Weights smaller than a page save nothing by sharing.
+                if (!shared_data && weight_store && num_bytes >= 4096) {
+                    shared_data = weight_store->Get(data, num_bytes);
+                }
+            }
+            if (shared_data) {
+                // Use memory-mapped weights without copies.
+                tensor = chainerx::FromData(shape, dtype, shared_data, nonstd::nullopt /* strides */, 0 /* offset */, device);
+            } else if (on_host) {
                 tensor = MakeHostArray(dtype, shape, data);
             } else {
                 tensor = MakeArray(dtype, shape, data);
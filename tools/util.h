@@ -12,9 +12,13 @@ class Graph;
 
 namespace runtime {
 
+class WeightStore;
+
 chainerx::Dtype ChainerXTypeFromONNX(int xtype);
 
-InOuts LoadParams(const Graph& graph);
+// If `weight_store` is given, parameters on the native device are
+// shared through it.
+InOuts LoadParams(const Graph& graph, WeightStore* weight_store = nullptr);
 
 }  // namespace runtime
 }  // namespace chainer_compiler
@@ -0,0 +1,75 @@
+#include "tools/weight_store.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <common/log.h>
+#include <common/mapped_file.h>
+#include <common/strutil.h>
+
+namespace chainer_compiler {
+namespace runtime {
+
+namespace {
+
+// FNV-1a.
+uint64_t HashBytes(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool FileExists(const std::string& filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0;
+}
+
+}  // namespace
+
+WeightStore::WeightStore(const std::string& dir) : dir_(dir) {
+    if (!FileExists(dir_)) CHECK_EQ(0, mkdir(dir_.c_str(), 0755)) << "Failed to create: " << dir_;
+}
+
+std::shared_ptr<void> WeightStore::Get(const void* data, size_t size) {
+    std::ostringstream oss;
+    oss << std::hex << std::setw(16) << std::setfill('0') << HashBytes(data, size);
+    const std::string filename = StrCat(dir_, '/', oss.str(), '_', size, ".bin");
+
+    if (!FileExists(filename)) {
+        // Other processes may be storing the same weights. Write to a
+        // private file and publish it by an atomic rename.
+        static std::atomic<int> counter{0};
+        const std::string tmp_filename = StrCat(filename, ".tmp.", getpid(), '.', counter++);
+        {
+            std::ofstream ofs(tmp_filename, std::ios::binary);
+            CHECK(ofs) << "Failed to open: " << tmp_filename;
+            ofs.write(static_cast<const char*>(data), size);
+            CHECK(ofs) << "Failed to write: " << tmp_filename;
+        }
+        CHECK_EQ(0, std::rename(tmp_filename.c_str(), filename.c_str())) << "Failed to rename: " << tmp_filename;
+    }
+
+    // Each caller gets its own mapping as weights may be updated in
+    // place.
+    std::shared_ptr<MappedFile> file = MapFilePrivate(filename);
+    if (file->size() != size || std::memcmp(file->data(), data, size)) {
+        WARN_ONCE("Hash collision in the weight store: " << filename);
+        return nullptr;
+    }
+    num_shared_bytes_ += size;
+    return std::shared_ptr<void>(file, file->data());
+}
+
+}  // namespace runtime
+}  // namespace chainer_compiler
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace chainer_compiler {
+namespace runtime {
+
+// A directory of weights keyed by hashes of their contents. Weights
+// are handed out as memory mappings of the stored files, so identical
+// tensors in different models and processes share physical pages
+// until they are written.
+class WeightStore {
+public:
+    explicit WeightStore(const std::string& dir);
+
+    // Returns a new private mapped copy of `data`, or nullptr if it
+    // cannot be shared (e.g., a hash collision).
+    std::shared_ptr<void> Get(const void* data, size_t size);
+
+    int64_t num_shared_bytes() const {
+        return num_shared_bytes_;
+    }
+
+private:
+    std::string dir_;
+    int64_t num_shared_bytes_ = 0;
+};
+
+}  // namespace runtime
+}  // namespace chainer_compiler